@@ -0,0 +1,59 @@
+Import("env")
+
+# Build step for the web assets in data/
+#
+# Defines ASSET_HASH_<NAME> for each file (name without .gz, e.g. ASSET_HASH_SLIDER_JS),
+# used as ETag and version parameter of static asset urls, see src/Assets.h
+#
+# With "custom_embed_assets = yes" in platformio.ini it also generates assets_embedded.h:
+# all files gzipped into a const table in flash, so the web server does not need the filesystem.
+
+import gzip
+import hashlib
+import os
+import re
+
+data_dir = os.path.join(env.get("PROJECT_DIR"), "data")
+embed = env.GetProjectOption("custom_embed_assets", "no").lower() in ("yes", "true", "1")
+
+types = {
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".html": "text/html",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+table = []
+for name in sorted(os.listdir(data_dir)):
+    path = os.path.join(data_dir, name)
+    if not os.path.isfile(path):
+        continue
+    with open(path, "rb") as f:
+        content = f.read()
+    digest = hashlib.sha1(content).hexdigest()[:8]
+    if name.endswith(".gz"):
+        name = name[:-3]
+    else:
+        content = gzip.compress(content, 9, mtime=0)
+    ident = re.sub(r"[^A-Za-z0-9]", "_", name)
+    env.Append(CPPDEFINES=[("ASSET_HASH_" + ident.upper(), env.StringifyMacro(digest))])
+    table.append((name, ident.lower(), types.get(os.path.splitext(name)[1], "text/plain"), digest, content))
+
+if embed:
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "assets")
+    os.makedirs(out_dir, exist_ok=True)
+    lines = ["// generated by assets.py from data/, do not edit", "#pragma once", ""]
+    for name, ident, _, _, content in table:
+        lines.append("static const uint8_t asset_%s[] PROGMEM = {" % ident)
+        for i in range(0, len(content), 24):
+            lines.append("    " + ",".join("0x%02x" % b for b in content[i:i + 24]) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("static const asset_t assets[] = {")
+    for name, ident, mime, digest, content in table:
+        lines.append('    { "/%s", "%s", "\\"%s\\"", asset_%s, sizeof(asset_%s) },' % (name, mime, digest, ident, ident))
+    lines.append("};")
+    with open(os.path.join(out_dir, "assets_embedded.h"), "w") as f:
+        f.write("\n".join(lines) + "\n")
+    env.Append(CPPPATH=[out_dir], CPPDEFINES=["EMBED_ASSETS"])
@@ -1,12 +1,70 @@
 // function to add server callbacks on value input or change to sliders
 
+// Sliders send binary frames over a websocket if available (see ws_frame() in main.cpp):
+// bytes 0-3 channel mask (bit 31 power), bytes 4-5 sequence number, then 16 bit values,
+// all little endian.
+// The server broadcasts the resulting state to all browsers in the same format.
+
+var sliderSocket = null;
+var sliderSeq = 0;
+var sliders = [];
+
+function sliderSocketOpen() {
+    if (!('WebSocket' in window)) return;
+
+    var ws = new WebSocket((location.protocol == 'https:' ? 'wss://' : 'ws://') + location.host + '/ws');
+    ws.binaryType = 'arraybuffer';
+    ws.onopen = function() { sliderSocket = ws; };
+    ws.onclose = function() {
+        sliderSocket = null;
+        setTimeout(sliderSocketOpen, 2000);
+    };
+    ws.onmessage = function(event) {
+        if (!(event.data instanceof ArrayBuffer) || event.data.byteLength < 6) return;
+        var frame = new DataView(event.data);
+        var mask = frame.getUint32(0, true);
+        var pos = 6;
+        for (var i = 0; i < 31 && pos + 2 <= frame.byteLength; i++) {
+            if (mask & (1 << i)) {
+                var s = sliders[i];
+                var v = frame.getUint16(pos, true);
+                if (s && !s.slider.hasAttribute('data-dragging')) {
+                    s.slider.value = v;
+                    s.value.innerHTML = v;
+                }
+                pos += 2;
+            }
+        }
+    };
+}
+
+function sliderSend(index, value) {
+    if (!sliderSocket || sliderSocket.readyState != WebSocket.OPEN) return false;
+
+    var frame = new DataView(new ArrayBuffer(8));
+    sliderSeq = (sliderSeq + 1) & 0xffff;
+    frame.setUint32(0, 1 << index, true);
+    frame.setUint16(4, sliderSeq, true);
+    frame.setUint16(6, value, true);
+    sliderSocket.send(frame.buffer);
+    return true;
+}
+
 function sliderCallback(sliderId, valueId, callbackUrl) {
 
     var slider = document.getElementById(sliderId);
     var value = document.getElementById(valueId);
+    var index = parseInt(sliderId.replace(/\D/g, ''));
+
+    sliders[index] = { slider: slider, value: value };
+    if (sliders.filter(Boolean).length == 1) {
+        sliderSocketOpen();
+    }
 
     slider.oninput = function() {
         value.innerHTML = this.value;
+        this.setAttribute('data-dragging', '');
+        if (sliderSend(index, this.value)) return;
         if (!this.hasAttribute('data-busy')) {
             this.setAttribute('data-busy', '');
             $.post({
@@ -19,6 +77,8 @@ function sliderCallback(sliderId, valueId, callbackUrl) {
     }
 
     slider.onchange = function() {
+        this.removeAttribute('data-dragging');
+        if (sliderSend(index, this.value)) return;
         $.post({
             url: callbackUrl,
             data: sliderId + "=" + this.value,
@@ -27,3 +87,19 @@ function sliderCallback(sliderId, valueId, callbackUrl) {
         });
     }
 }
+
+// Build one slider row per channel (see fill_channels() in main.cpp): channels is [[name, value], ...]
+function sliderTable(containerId, channels, callbackUrl) {
+    var container = document.getElementById(containerId);
+
+    channels.forEach(function(channel, i) {
+        var row = document.createElement('div');
+        row.className = 'row my-4';
+        row.innerHTML =
+            '<div class="col-2"><label for="slider' + i + '">' + channel[0] + '</label></div>' +
+            '<div class="col-8"><input style="width:100%" id="slider' + i + '" type="range" min="0" max="1000" step="1" value="' + channel[1] + '"></div>' +
+            '<div class="col-2"><div class="float-end" id="sliderValue' + i + '">' + channel[1] + '</div></div>';
+        container.appendChild(row);
+        sliderCallback('slider' + i, 'sliderValue' + i, callbackUrl);
+    });
+}
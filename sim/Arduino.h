@@ -0,0 +1,54 @@
+#pragma once
+
+// Stand-in for the Arduino core in the native simulation build (see sim.h)
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include <WString.h>
+#include <HardwareSerial.h>
+#include <Esp.h>
+
+using std::min;
+using std::max;
+
+#ifndef ESP32
+#define ESP32 1  // simulate the plain ESP32 variant of the firmware
+#endif
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define memcpy_P memcpy
+
+uint32_t millis();
+uint32_t micros();
+void delay( uint32_t ms );
+
+long map( long x, long in_min, long in_max, long out_min, long out_max );
+
+void pinMode( uint8_t pin, uint8_t mode );
+int digitalRead( uint8_t pin );
+void digitalWrite( uint8_t pin, uint8_t val );
+
+bool ledcAttach( uint8_t pin, uint32_t freq, uint8_t resolution );
+bool ledcDetach( uint8_t pin );
+bool ledcWrite( uint8_t pin, uint32_t duty );
+void analogWrite( uint8_t pin, int value );
+void analogWriteRange( uint32_t range );
+void rgbLedWrite( uint8_t pin, uint8_t red, uint8_t green, uint8_t blue );
+
+char *itoa( int value, char *str, int base );
+void configTime( long gmtOffset_sec, int daylightOffset_sec, const char *server1 );  // host clock is used as is
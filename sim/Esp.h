@@ -0,0 +1,22 @@
+#pragma once
+
+// Stand-in for the ESP object of the Arduino core in the native builds (see Arduino.h)
+// The heap is the one of the host process: free bytes of the malloc arena,
+// the minimum is the lowest value seen by calls, not a true low water mark
+
+#include <stdint.h>
+
+class EspClass {
+    public:
+        EspClass() : _min_free(UINT32_MAX) {}
+
+        uint32_t getFreeHeap();
+        uint32_t getMinFreeHeap();
+        uint32_t getFreeSketchSpace() { return 0x1e0000; }  // ota slot of min_spiffs.csv
+        [[noreturn]] void restart();  // ends the process
+
+    private:
+        uint32_t _min_free;
+};
+
+extern EspClass ESP;
@@ -0,0 +1,37 @@
+#pragma once
+
+// Stand-in for the ESP32 HTTPClient in the native simulation build
+// Just enough HTTP/1.1 for posts with keep-alive: Content-Length bodies, no chunked responses
+
+#include <WiFi.h>
+
+#include <string>
+
+class HTTPClient {
+    public:
+        HTTPClient() : _client(NULL), _port(0), _reuse(true), _timeout_ms(5000), _size(-1), _connects(0) {}
+
+        void setReuse( bool reuse ) { _reuse = reuse; }
+        void setUserAgent( const char *agent ) { _agent = agent; }
+        void setTimeout( uint16_t ms ) { _timeout_ms = ms; }
+
+        bool begin( WiFiClient &client, const char *host, uint16_t port, const char *uri );
+        int POST( const uint8_t *payload, size_t len );  // http status or negative on error
+        int getSize() const { return _size; }  // body length of the response, -1 if unknown
+        const std::string &getString() const { return _body; }
+        void end();
+
+        uint32_t connects() const { return _connects; }  // new connections, to see keep-alive working
+
+    private:
+        WiFiClient *_client;
+        std::string _host;
+        uint16_t _port;
+        std::string _uri;
+        std::string _agent;
+        bool _reuse;
+        uint16_t _timeout_ms;
+        int _size;
+        std::string _body;
+        uint32_t _connects;
+};
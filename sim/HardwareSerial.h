@@ -0,0 +1,40 @@
+#pragma once
+
+// Stand-in for the Arduino Print and Serial in the native builds (see Arduino.h)
+// Serial writes to stdout
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write( const uint8_t *data, size_t len ) = 0;
+
+        size_t write( uint8_t c ) { return write(&c, 1); }
+        size_t print( const char *s ) { return write((const uint8_t *)s, strlen(s)); }
+        size_t println( const char *s = "" ) { return print(s) + print("\r\n"); }
+
+        size_t printf( const char *format, ... ) __attribute__((format(printf, 2, 3))) {
+            char buf[256];
+            va_list args;
+            va_start(args, format);
+            int len = vsnprintf(buf, sizeof(buf), format, args);
+            va_end(args);
+            if (len < 0) return 0;
+            return write((const uint8_t *)buf, (size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+        }
+};
+
+class HardwareSerial : public Print {
+    public:
+        using Print::write;
+
+        void begin( unsigned long baud ) {}
+        size_t write( const uint8_t *data, size_t len ) override { return fwrite(data, 1, len, stdout); }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,35 @@
+#pragma once
+
+// Stand-in for the ESP32 Preferences (NVS) library in the native simulation build
+// Values live in memory for the whole simulation, every put is counted as flash write
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+    public:
+        bool begin( const char *name, bool readOnly = false, const char *partition = NULL );
+        void end();
+
+        bool isKey( const char *key );
+        bool remove( const char *key );
+
+        size_t putBool( const char *key, bool value );
+        size_t putInt( const char *key, int32_t value );
+        size_t putUInt( const char *key, uint32_t value );
+        size_t putBytes( const char *key, const void *value, size_t len );
+
+        bool getBool( const char *key, bool defaultValue = false );
+        int32_t getInt( const char *key, int32_t defaultValue = 0 );
+        uint32_t getUInt( const char *key, uint32_t defaultValue = 0 );
+        size_t getBytesLength( const char *key );
+        size_t getBytes( const char *key, void *buf, size_t maxLen );
+
+    private:
+        std::string _ns;
+        size_t put( const char *key, const void *value, size_t len );
+        bool get( const char *key, void *value, size_t len );
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+// Stand-in for the Arduino String in the native builds (see Arduino.h)
+// Only what the firmware uses, backed by std::string
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <strings.h>
+#include <string>
+
+class String {
+    public:
+        String( const char *s = "" ) : _s(s ? s : "") {}
+        String( const char *s, size_t len ) : _s(s, len) {}
+        String( const std::string &s ) : _s(s) {}
+
+        const char *c_str() const { return _s.c_str(); }
+        size_t length() const { return _s.length(); }
+        bool isEmpty() const { return _s.empty(); }
+        long toInt() const { return atol(_s.c_str()); }
+        bool equals( const String &s ) const { return _s == s._s; }
+        bool equalsIgnoreCase( const String &s ) const { return strcasecmp(c_str(), s.c_str()) == 0; }
+        void toLowerCase() { for (char &c : _s) c = tolower((unsigned char)c); }
+
+        String &operator+=( const String &s ) { _s += s._s; return *this; }
+        bool operator==( const String &s ) const { return _s == s._s; }
+        bool operator!=( const String &s ) const { return _s != s._s; }
+        char operator[]( size_t i ) const { return _s[i]; }
+
+        friend String operator+( String a, const String &b ) { return a += b; }
+
+    private:
+        std::string _s;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+// Stand-in for the ESP32 WiFi library in the native simulation build
+// The network is the host network: always connected, clients are POSIX tcp sockets
+
+#include <Arduino.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+
+class IPAddress {
+    public:
+        IPAddress( uint8_t a, uint8_t b, uint8_t c, uint8_t d ) : _ip{ a, b, c, d } {}
+
+        String toString() const {
+            char str[16];
+            snprintf(str, sizeof(str), "%u.%u.%u.%u", _ip[0], _ip[1], _ip[2], _ip[3]);
+            return String(str);
+        }
+
+    private:
+        uint8_t _ip[4];
+};
+
+class WiFiClass {
+    public:
+        bool isConnected() { return true; }
+
+        bool mode( wifi_mode_t mode ) { return true; }
+        bool hostname( const char *name ) { _hostname = name; return true; }
+        const char *getHostname() { return _hostname.c_str(); }
+        IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+        int8_t RSSI() { return -50; }
+        uint8_t *BSSID() { return _bssid; }
+        bool reconnect() { return true; }
+
+    private:
+        String _hostname;
+        uint8_t _bssid[6] = { 0 };
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient {
+    public:
+        WiFiClient() : _fd(-1) {}
+        ~WiFiClient() { stop(); }
+
+        bool connect( const char *host, uint16_t port, uint32_t timeout_ms );
+        bool connected() const { return _fd >= 0; }
+        void stop();
+
+        bool write( const void *data, size_t len );
+        int read( void *buf, size_t len );  // bytes received, 0 if closed, -1 on error
+
+    private:
+        int _fd;
+};
+
+class WiFiUDP {};  // only passed to Syslog, which does not send in the host build
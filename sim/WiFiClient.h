@@ -0,0 +1,5 @@
+#pragma once
+
+// Stand-in for WiFiClient.h, the client is part of the WiFi stand-in
+
+#include <WiFi.h>
@@ -0,0 +1,778 @@
+/*
+Native simulation of SliderPwm logic with a virtual clock
+
+Runs app (fades and flash save coalescing), health led breathing and button
+debouncing from the same scheduler setup as the firmware loop(), but faster
+than real time. Scripted inputs: a bouncing button press every 10 minutes
+and a slider drag (50 values within a second) every 7 minutes.
+
+Also checks the led strip encoder (see StripEncode.h): a frame is packed,
+encoded to RMT symbols and decoded again, and the encoding time is measured.
+The effect render kernels (see Effects.h) are timed per frame.
+Waveforms (see Waveform.h) are checked against the old cycle by cycle phase.
+Dithering (see Dither.h) is checked for the average duty of low slider values.
+Phase staggering (see Stagger.h) reports peak and rms supply current of duty sets.
+The power limit (see Power.h) is checked with 4 x 15 W channels in a 30 W budget.
+Button gestures (see Button.h) are checked for their effect and press to light latency.
+Recorded mqtt payloads (see Commands.h) are checked and their parse throughput measured.
+The influx writer (see Influx.h) posts to a stand-in server on the loopback.
+The seqlock (see Seqlock.h) is stressed with 2 writer and 3 reader threads.
+The chunked page template (see Template.h) is checked for truncation and timed against one snprintf.
+Duty tables (see Gamma.h) are checked and timed against the old runtime value2duty().
+
+Usage: sim [hours [pwm.csv [pwm.vcd]]]
+*/
+
+#include <Arduino.h>
+#include <sim.h>
+
+#include <app.h>
+#include <Breathing.h>
+#include <Button.h>
+#include <Commands.h>
+#include <Scheduler.h>
+#include <StripEncode.h>
+#include <Effects.h>
+#include <Dither.h>
+#include <Gamma.h>
+#include <Influx.h>
+#include <Pwm.h>
+#include <Stagger.h>
+#include <Template.h>
+#include <Seqlock.h>
+#include <Waveform.h>
+
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BUTTON_PIN 0
+#define HEALTH_LED_PIN 2
+
+Breathing health_led(5000, HEALTH_LED_PIN, false, HEALTH_LED_PIN);
+Button button(BUTTON_PIN);
+Scheduler scheduler;
+
+#define BUTTON_RAMP_STEP 20
+
+// same gestures as the firmware: click toggles, double click full, hold ramps
+void task_button() {
+    static app_snapshot_t mix;
+    static int level = 0;
+    static int step = BUTTON_RAMP_STEP;
+
+    button.handle();
+    button_event_t e;
+    while (button.event(e)) {
+        switch (e.type) {
+            case BUTTON_CLICK:
+                app_status(true, get_fade());
+                break;
+            case BUTTON_DOUBLE:
+                app_snapshot(mix);
+                app_level(mix, 1000, get_fade());
+                break;
+            case BUTTON_HOLD:
+                app_snapshot(mix);
+                level = 0;
+                if (mix.on) {
+                    for (int led = 0; led < LED_COUNT; led++) {
+                        if (mix.value[led] > level) level = mix.value[led];
+                    }
+                }
+                step = (level <= BUTTON_RAMP_STEP) ? BUTTON_RAMP_STEP : (level >= 1000) ? -BUTTON_RAMP_STEP : -step;
+                // fall through: first step
+            case BUTTON_REPEAT:
+                if (level + step >= 1 && level + step <= 1000) {
+                    level += step;
+                    app_level(mix, level, BUTTON_REPEAT_MS);
+                }
+                break;
+            default:
+                continue;
+        }
+        if (e.type != BUTTON_REPEAT) button.applied(e);
+    }
+}
+
+void task_app() { handle_app(); }
+void task_breathe() { health_led.handle(); }
+
+// run the loop for ms of virtual time
+void run_ms( uint32_t ms ) {
+    while (ms--) {
+        while (scheduler.run());
+        sim_advance(1);
+    }
+}
+
+// scripted press: bounces, held for 300 ms, bounces on release
+void press_button() {
+    static const uint8_t bounces[] = { 1, 2, 1, 3, 1 };
+    for (uint8_t ms : bounces) {
+        sim_input(BUTTON_PIN, LOW);
+        run_ms(ms);
+        sim_input(BUTTON_PIN, HIGH);
+        run_ms(1);
+    }
+    sim_input(BUTTON_PIN, LOW);
+}
+
+void release_button() {
+    sim_input(BUTTON_PIN, HIGH);
+}
+
+// pack, encode and decode a strip frame, print timing, false on mismatch
+bool check_strip( uint16_t pixels, strip_order_t order ) {
+    size_t bytes = pixels * strip_bytes(order);
+    std::vector<uint8_t> frame(bytes), decoded(bytes);
+    std::vector<uint32_t> symbols(bytes * 8);
+    uint32_t bit[2];
+    strip_bit_symbols(STRIP_WS2812, 10000000, bit);
+
+    for (uint16_t i = 0; i < pixels; i++) {
+        strip_pack(order, &frame[i * strip_bytes(order)], i * 7, i * 13, i * 31, i);
+    }
+
+    const int rounds = 100;
+    size_t n = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        n = strip_encode(frame.data(), bytes, bit, symbols.data(), symbols.size());
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    // decode by high time: a 1 bit is high longer than a 0 bit
+    uint32_t threshold = ((bit[0] & 0x7fff) + (bit[1] & 0x7fff)) / 2;
+    for (size_t i = 0; i < n; i++) {
+        decoded[i / 8] = (decoded[i / 8] << 1) | ((symbols[i] & 0x7fff) > threshold);
+    }
+    bool ok = n == bytes * 8 && decoded == frame && strip_pack(order, &frame[0], 1, 2, 3) == strip_bytes(order)
+        && (frame[0] == (order == STRIP_RGB ? 1 : 2));
+
+    uint32_t bit_ns = ((bit[0] & 0x7fff) + (bit[0] >> 16 & 0x7fff)) * 100;
+    printf("strip: %u pixels, %u symbols encoded in %.1f us (%.1f ns per pixel), %u bytes ram per pixel, "
+        "frame on wire %.0f us (max %.0f fps) %s\n",
+        pixels, (unsigned)n, ns / 1000, ns / pixels, (unsigned)(2 * strip_bytes(order)),
+        (double)n * bit_ns / 1000 + STRIP_WS2812.reset_us,
+        1e6 / ((double)n * bit_ns / 1000 + STRIP_WS2812.reset_us), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// time the effect kernels on a strip of the given length
+void bench_effects( uint16_t pixels, strip_order_t order ) {
+    std::vector<uint8_t> buf(pixels * strip_bytes(order));
+    effect_params_t p = { EFFECT_OFF, 128, 3, 255, 0, { 255, 80, 0, 0 }, { 0, 0, 255, 0 } };
+    uint32_t seed = 1;
+
+    for (int e = EFFECT_RAINBOW; e < EFFECT_COUNT; e++) {
+        p.effect = e;
+        const int rounds = 1000;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            effects_render(p, r * 20, buf.data(), pixels, order, seed);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+        printf("effect %-8s %u pixels: %.1f us per frame (%.1f ns per pixel)\n", effects_name(e), pixels, ns / 1000, ns / pixels);
+    }
+}
+
+// O(1) phase must match stepping cycle by cycle, levels must span the limits
+bool check_waves() {
+    const uint32_t period = 4000, min = 10, max = 900;
+    bool ok = true;
+    for (int s = 0; s < WAVE_CUSTOM; s++) {
+        Waveform w(static_cast<wave_shape_t>(s), period, min, max);
+        w.start(1000);
+        uint32_t start = 1000, lo = UINT32_MAX, hi = 0, errors = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t now = 1000; now < 1000 + 100 * period; now += 3) {
+            while (now - start >= period) start += period;  // what Breathing::handle() did
+            if (w.phase(now) != ((uint64_t)(now - start) << 16) / period) errors++;
+            uint32_t v = w.value(now);
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / (100 * period / 3);
+        bool span = lo <= min + (max - min) / 100 && hi >= max - (max - min) / 100 && lo >= min && hi <= max;
+        printf("wave %-8s %u..%u, %u phase errors, %.1f ns per value\n", wave_name(s), lo, hi, errors, ns);
+        ok = ok && span && !errors;
+    }
+
+    Waveform w(WAVE_SINE, 1000);
+    w.start(0);
+    uint16_t before = w.phase(250);
+    w.period(3000, 250);
+    int diff = (int)w.phase(250) - before;
+    if (diff < -2 || diff > 2) {
+        printf("wave period change moved the phase by %d\n", diff);
+        ok = false;
+    }
+    return ok;
+}
+
+// average of the dithered duties must hit the fine target, count the steps of dim slider values
+bool check_dither() {
+    static constexpr GammaTable<CURVE_QUADRATIC, 1023> coarse;
+    static constexpr GammaTable<CURVE_QUADRATIC, 1023, 220, DITHER_BITS> fine;
+    const uint32_t ticks = 64 << DITHER_BITS;
+    const uint32_t values = 200;  // dim end of the slider
+
+    double max_error = 0;
+    uint32_t coarse_steps = 0, fine_steps = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t v = 1; v <= values; v++) {
+        uint32_t acc = 0;
+        uint64_t sum = 0;
+        for (uint32_t t = 0; t < ticks; t++) {
+            sum += dither_step(acc, fine.duty[v], DITHER_BITS);
+        }
+        double error = fabs((double)sum / ticks - fine.duty[v] / (double)(1 << DITHER_BITS));
+        if (error > max_error) max_error = error;
+        coarse_steps += coarse.duty[v] != coarse.duty[v - 1];
+        fine_steps += fine.duty[v] != fine.duty[v - 1];
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (values * ticks);
+    printf("dither: %u bits, slider 1..%u has %u duty steps (%u without), average error %.4f duty, %.1f ns per channel tick\n",
+        DITHER_BITS, values, fine_steps, coarse_steps, max_error, ns);
+    return max_error < 1.0 / ticks;
+}
+
+// combined current of 4 channels with 1.25 A each (5 A total) with and without phase offsets
+bool check_stagger() {
+    static const uint32_t percent[][4] = {
+        { 25, 25, 25, 25 }, { 10, 20, 30, 40 }, { 50, 50, 50, 50 }, { 90, 10, 30, 60 }, { 100, 5, 5, 5 }
+    };
+    const uint32_t period = 2048;  // 11 bits at 25 kHz
+    const uint32_t ma[4] = { 1250, 1250, 1250, 1250 };
+    bool ok = true;
+    for (const uint32_t *p : percent) {
+        uint32_t duty[4], aligned[4] = { 0 }, hpoint[4], sum = 0;
+        for (int i = 0; i < 4; i++) {
+            duty[i] = p[i] * period / 100;
+            sum += duty[i];
+        }
+        stagger(duty, ma, 4, period, hpoint);
+
+        uint32_t peak_a, peak_s;
+        double rms_a, rms_s;
+        stagger_current(duty, aligned, ma, 4, period, peak_a, rms_a);
+        stagger_current(duty, hpoint, ma, 4, period, peak_s, rms_s);
+        printf("stagger %u/%u/%u/%u%%: aligned peak %.2f A rms %.2f A, staggered peak %.2f A rms %.2f A\n",
+            p[0], p[1], p[2], p[3], peak_a / 1000.0, rms_a / 1000, peak_s / 1000.0, rms_s / 1000);
+
+        // pulses must stay within the period, fitting duties must not overlap
+        for (int i = 0; i < 4; i++) {
+            if (hpoint[i] + duty[i] > period) ok = false;
+        }
+        if (sum <= period && peak_s > ma[0]) ok = false;
+        if (peak_s > peak_a || rms_s > rms_a + 1e-9) ok = false;
+    }
+    return ok;
+}
+
+// all channels full within a budget of half their power: scaled evenly, never above budget,
+// an hour at the limit gives the budget in Wh, the limit is lifted again without budget
+bool check_power() {
+    const uint32_t channel_mw = 15000, budget_mw = 30000;
+    bool ok = true;
+
+    app_frame_t frame;
+    app_begin(frame);
+    for (int i = LED_START; i < LED_COUNT; i++) {
+        app_load(static_cast<led_t>(i), channel_mw);
+        app_stage(frame, static_cast<led_t>(i), 1000);
+    }
+    app_budget(budget_mw);
+    app_stage_power(frame, true);
+    app_commit(frame, 0);
+
+    uint32_t load = 0;
+    for (int i = LED_START; i < LED_COUNT; i++) {
+        led_t led = static_cast<led_t>(i);
+        load += (uint64_t)channel_mw * get_duty(led) / get_range(led);
+        if (get_duty(led) != get_duty(LED_START)) ok = false;  // same scale for all
+    }
+    if (load > budget_mw || load < budget_mw * 99 / 100) ok = false;
+
+    uint32_t mwh = 0;
+    for (int i = LED_START; i < LED_COUNT; i++) mwh -= get_energy_mwh(static_cast<led_t>(i));
+    run_ms(3600 * 1000);
+    for (int i = LED_START; i < LED_COUNT; i++) mwh += get_energy_mwh(static_cast<led_t>(i));
+    if (mwh > budget_mw || mwh < budget_mw * 99 / 100) ok = false;
+
+    // cost of a commit of one channel with the limit active
+    const int rounds = 100000;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) app_value(LED_START, 900 + r % 100);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    printf("power: %u x %.1f W in %.1f W budget: limit %u per mille, load %.2f W, %.3f Wh in 1 h, commit %.0f ns\n",
+        LED_COUNT, channel_mw / 1000.0, budget_mw / 1000.0, get_limit_pm(), load / 1000.0, mwh / 1000.0, ns);
+
+    app_budget(0);
+    if (get_limit_pm() != 1000) ok = false;
+    return ok;
+}
+
+// click toggles, double click scales the mix to full, a hold ramps it down keeping the ratio
+bool check_button() {
+    bool ok = true;
+    app_frame_t frame;
+    app_begin(frame);
+    for (int i = 0; i < LED_COUNT; i++) app_stage(frame, static_cast<led_t>(i), i == LED_START ? 400 : 200);
+    app_stage_power(frame, true);
+    app_commit(frame, 0);
+    run_ms(1000);
+
+    press_button();
+    run_ms(100);
+    release_button();
+    run_ms(BUTTON_DOUBLE_MS + 50);
+    if (get_power()) ok = false;
+    uint32_t click_ms = button.latency_ms();
+
+    press_button();
+    run_ms(100);
+    release_button();
+    run_ms(100);
+    press_button();
+    run_ms(100);
+    release_button();
+    run_ms(BUTTON_DOUBLE_MS + 50);
+    led_t other = static_cast<led_t>(LED_START ? 0 : LED_COUNT - 1);
+    if (!get_power() || get_value(LED_START) != 1000 || (other != LED_START && get_value(other) != 500)) ok = false;
+    uint32_t double_ms = button.latency_ms();
+
+    press_button();
+    run_ms(BUTTON_LONG_MS + 20 * BUTTON_REPEAT_MS);
+    release_button();
+    run_ms(BUTTON_DOUBLE_MS + 50);
+    int top = get_value(LED_START);
+    if (!get_power() || top != 1000 - 21 * BUTTON_RAMP_STEP) ok = false;
+    uint32_t hold_ms = button.latency_ms();
+
+    printf("button: click %u ms, double click %u ms, hold %u ms press to light, ramp to %d, max wait %u ms, "
+        "%u events, %u dropped %s\n", click_ms, double_ms, hold_ms, top, button.max_wait_ms(), button.events(),
+        button.dropped(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// stand-in InfluxDB on the loopback: answers posts with status, counts connections, posts and stored lines
+typedef struct {
+    int fd;
+    uint16_t port;
+    std::atomic<int> status;
+    std::atomic<uint32_t> connections, posts, lines;
+} influx_server_t;
+
+static void influx_serve( influx_server_t *server ) {
+    int client;
+    while ((client = accept(server->fd, NULL, NULL)) >= 0) {
+        server->connections++;
+        std::string in;
+        char buf[4096];
+        ssize_t n = 0;
+        while (true) {
+            size_t end;
+            while ((end = in.find("\r\n\r\n")) == std::string::npos && (n = recv(client, buf, sizeof(buf), 0)) > 0) {
+                in.append(buf, n);
+            }
+            if (end == std::string::npos) break;  // closed by the client
+            const char *cl = strcasestr(in.c_str(), "Content-Length:");
+            size_t len = cl ? atoi(cl + 15) : 0;
+            while (in.size() < end + 4 + len && (n = recv(client, buf, sizeof(buf), 0)) > 0) in.append(buf, n);
+            if (in.size() < end + 4 + len) break;
+            std::string body = in.substr(end + 4, len);
+            in.erase(0, end + 4 + len);
+            server->posts++;
+            if (server->status >= 200 && server->status < 300) {  // stored
+                server->lines += std::count(body.begin(), body.end(), '\n');
+            }
+            int l = snprintf(buf, sizeof(buf), "HTTP/1.1 %d Stand-in\r\nContent-Length: 0\r\n\r\n", server->status.load());
+            send(client, buf, l, MSG_NOSIGNAL);
+        }
+        close(client);
+    }
+}
+
+// buffered influx writer against the stand-in: batching, keep-alive, backoff, overflow and rejects
+bool check_influx() {
+    static influx_server_t server;
+    server.fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(server.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(server.fd, 4) != 0
+            || getsockname(server.fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        printf("influx: no loopback socket, skipped\n");
+        close(server.fd);
+        return true;
+    }
+    server.port = ntohs(addr.sin_port);
+    server.status = 204;
+    std::thread serve(influx_serve, &server);
+
+    static Influx influx("127.0.0.1", server.port, "sim", "sim");
+    influx.begin();
+    const char *line = "pwm,host=sim r=500i,g=250i,b=0i,w=1000i";
+    bool ok = true;
+
+    for (int i = 0; i < 10; i++) influx.add(line);
+    influx.handle();
+    ok = ok && server.posts == 1 && server.lines == 10 && influx.queued() == 0 && influx.status() == 204;
+
+    server.status = 503;  // database down: keep the points, retry after 1 s, 2 s, ...
+    for (int i = 0; i < 5; i++) influx.add(line);
+    influx.handle();
+    influx.handle();
+    ok = ok && server.posts == 2 && influx.queued() == 5;
+    sim_advance(1000);
+    influx.handle();
+    sim_advance(1000);
+    influx.handle();
+    ok = ok && server.posts == 3;
+    server.status = 204;
+    sim_advance(1000);
+    influx.handle();
+    ok = ok && server.posts == 4 && server.lines == 15 && influx.queued() == 0;
+
+    server.status = 503;  // full buffer drops new points
+    for (int i = 0; i < INFLUX_LINES + 3; i++) influx.add(line);
+    influx.handle();
+    ok = ok && influx.dropped() == 3 && influx.queued() == INFLUX_LINES;
+    server.status = 400;  // rejected points are dropped, not retried
+    sim_advance(2000);
+    influx.handle();
+    ok = ok && influx.dropped() == 3 + INFLUX_LINES && influx.queued() == 0;
+
+    server.status = 204;
+    const int rounds = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < INFLUX_LINES; i++) influx.add(line);
+        influx.handle();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+    ok = ok && influx.queued() == 0 && server.connections == 1;
+
+    printf("influx: %u posts, %u lines, %u dropped, %u connection, batch of %u points in %.1f us (%.0f points/s) %s\n",
+        server.posts.load(), server.lines.load(), influx.dropped(), server.connections.load(), INFLUX_LINES, us,
+        INFLUX_LINES * 1e6 / us, ok ? "ok" : "FAILED");
+
+    shutdown(server.fd, SHUT_RDWR);
+    close(server.fd);
+    serve.detach();  // blocked on the kept connection until exit
+    return ok;
+}
+
+// recorded payloads of a home automation controller: results and parse plus commit throughput
+bool check_commands() {
+    static const char *const payloads[] = {
+        "fade 0; color 1000 500 0 200; on",
+        "red 300",
+        "channel 1 0x1f4 250",
+        "group 1 700; on 500",
+        "toggle",
+        "toggle 1000",
+        "off; fade 1500 linear",
+        "on;;  color 0 0 0 0 0",
+        "bogus 1; brightness 3; on",
+        "green; blue 2000",
+        "color 10 20 30 40 100; on",
+    };
+    const size_t count = sizeof(payloads) / sizeof(*payloads);
+    size_t lens[count];
+    for (size_t i = 0; i < count; i++) lens[i] = strlen(payloads[i]);
+
+    uint32_t fade = get_fade();
+    Fade::curve_t curve = get_curve();
+    command_stats_t before = get_command_stats();
+    size_t executed = 0;
+    for (size_t i = 0; i < count; i++) executed += command_execute(payloads[i], lens[i]);
+    command_stats_t after = get_command_stats();
+
+    // last payload: one frame with all values and power, the default fade is back from "off; fade 1500 linear"
+    bool ok = executed == 17 && after.unknown - before.unknown == 2 && after.invalid - before.invalid == 1
+        && get_power() && get_fade() == 1500 && get_curve() == Fade::LINEAR;
+    for (int i = 0; i < LED_COUNT && i < 4; i++) {
+        if (get_value(static_cast<led_t>(i)) != 10 * (i + 1)) ok = false;
+    }
+
+    const int rounds = 20000;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) command_execute(payloads[i], lens[i]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+        / (rounds * count);
+    app_fade(fade);
+    app_curve(curve);
+
+    printf("commands: %u payloads, %u commands, %u unknown, %u invalid, %.0f ns per payload (%.0f k/s) %s\n",
+        (unsigned)count, (unsigned)executed, after.unknown - before.unknown, after.invalid - before.invalid,
+        ns, 1e6 / ns, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static std::string template_render( const Template &t, size_t chunk ) {
+    std::string out;
+    std::vector<char> buf(chunk);
+    size_t pos = 0;
+    size_t len;
+    while ((len = t.render(buf.data(), chunk, pos)) > 0) {
+        if (memchr(buf.data(), '\0', len)) out += "<NUL>";
+        out.append(buf.data(), len);
+    }
+    return out;
+}
+
+static int template_value;  // counts up, so every placeholder gets its own value, 4 digits in the page
+
+// truncation of values longer than a chunk, then a page like main_page in tcp sized chunks vs. one snprintf
+bool check_template() {
+    static const Template::var_t vars[] = {
+        { "long", []( char *buf, size_t maxlen ) { return snprintf(buf, maxlen, "%s", "0123456789abcdefghijklmnopqrstuvwxyz"); } },
+        { "short", []( char *buf, size_t maxlen ) { return snprintf(buf, maxlen, "xyz"); } },
+        { "liar", []( char *buf, size_t maxlen ) { snprintf(buf, maxlen, "xyz"); return 100; } },  // claims more than it wrote
+        { "value", []( char *buf, size_t maxlen ) { return snprintf(buf, maxlen, "%d", template_value++); } },
+    };
+    const size_t count = sizeof(vars) / sizeof(*vars);
+    bool ok = template_render(Template("ab%long%cd", vars, count), 16) == "ab0123456789abcdecd"
+        && template_render(Template("%liar%|%short%|100%%|%none%", vars, count), 16) == "xyz|xyz|100%|%none%"
+        && template_render(Template("%liar%", vars, count), 2) == "x";
+
+    // 8 slider rows with a value each, about the size of the main page
+    const char *row =
+        "    <div class=\"row my-4\">\n"
+        "     <div class=\"col-10\">\n"
+        "      <input style=\"width:100%%\" class=\"form-range\" type=\"range\" min=\"0\" max=\"1000\" step=\"1\" value=\"@\">\n"
+        "     </div>\n"
+        "     <div class=\"col-2\">\n"
+        "      <div class=\"float-end\">@</div>\n"
+        "     </div>\n"
+        "    </div>\n"
+        "    <!-- padding to the size of a main page row with its scripts and styles ............................. -->\n"
+        "    <!-- ................................................................................................. -->\n"
+        "    <!-- ................................................................................................. -->\n";
+    std::string text, fmt;
+    for (int i = 0; i < 8; i++) {
+        for (const char *c = row; *c; c++) {
+            text += (*c == '@') ? std::string("%value%") : std::string(1, *c);
+            fmt += (*c == '@') ? std::string("%d") : std::string(1, *c);
+        }
+    }
+    Template page(text.c_str(), vars, count);
+    std::vector<char> buffer(fmt.size() + 500);  // static page buffer of the old main_page()
+
+    const size_t chunk = 1436;  // tcp segment
+    const int rounds = 20000;
+    std::vector<char> buf(chunk);
+    double first_ns = 0;
+    size_t chunks = 0;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        size_t pos = 0;
+        size_t len;
+        template_value = 1000;
+        auto begin = std::chrono::steady_clock::now();
+        len = page.render(buf.data(), chunk, pos);
+        first_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        for (; len > 0; len = page.render(buf.data(), chunk, pos)) {
+            chunks++;
+            bytes += len;
+        }
+    }
+    auto mid = std::chrono::steady_clock::now();
+    const size_t size = bytes / rounds;
+    for (int r = 0; r < rounds; r++) {
+        int v = 1000;
+        bytes -= snprintf(buffer.data(), buffer.size(), fmt.c_str(), v, v + 1, v + 2, v + 3, v + 4, v + 5, v + 6, v + 7,
+            v + 8, v + 9, v + 10, v + 11, v + 12, v + 13, v + 14, v + 15);
+    }
+    auto end = std::chrono::steady_clock::now();
+    ok = ok && bytes == 0;  // same page size both ways
+
+    double chunked_us = std::chrono::duration<double, std::micro>(mid - start).count() / rounds;
+    double snprintf_us = std::chrono::duration<double, std::micro>(end - mid).count() / rounds;
+    printf("template: %u byte page in %u chunks: first chunk %.2f us, page %.2f us, one snprintf %.2f us,"
+        " buffer %u bytes per request vs. %u static %s\n",
+        (unsigned)size, (unsigned)(chunks / rounds), first_ns / rounds / 1000, chunked_us, snprintf_us,
+        (unsigned)sizeof(size_t), (unsigned)buffer.size(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// slider value to duty as computed at runtime before the tables (quadratic curve only)
+static uint32_t old_value2duty( int value ) {
+    const int min_value = sqrt(PWMRANGE);
+    if (value > 0) value += min_value;
+    uint32_t new_duty = (PWMRANGE * value) / (1000 + min_value);
+    new_duty *= new_duty;
+    new_duty /= PWMRANGE;
+    return new_duty;
+}
+
+volatile uint32_t gamma_sink;
+
+// quadratic table must match the old curve, lookup time per value vs. the old formula
+bool check_gamma() {
+    static constexpr GammaTable<CURVE_QUADRATIC, PWMRANGE> table;
+    static constexpr GammaTable<CURVE_QUADRATIC, PWMRANGE, 220, PWM_BITS_MAX - PWMBITS> fine;
+    bool ok = true;
+    for (int value = 0; value <= GAMMA_VALUE_MAX; value++) {
+        if (table.duty[value] != old_value2duty(value)) ok = false;
+    }
+
+    // slider drags in random order, so neither loop is vectorized over consecutive values
+    static uint16_t values[4096];
+    uint32_t seed = 1;
+    for (auto &value : values) {
+        seed = seed * 1103515245 + 12345;
+        value = (seed >> 16) % (GAMMA_VALUE_MAX + 1);
+    }
+    volatile uint32_t range = PWMRANGE;  // channel range is runtime config in the firmware
+    const uint32_t max = fine.duty[GAMMA_VALUE_MAX];
+    const int rounds = 2000;
+    uint32_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint16_t value : values) sum += old_value2duty(value);
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        uint32_t scale = range;
+        for (uint16_t value : values) sum += (fine.duty[value] * scale + max / 2) / max;  // as app value2duty()
+    }
+    auto end = std::chrono::steady_clock::now();
+    gamma_sink = sum;  // keep both loops
+
+    const double n = (double)rounds * sizeof(values) / sizeof(*values);
+    double old_ns = std::chrono::duration<double, std::nano>(mid - start).count() / n;
+    double new_ns = std::chrono::duration<double, std::nano>(end - mid).count() / n;
+    printf("gamma: old value2duty %.2f ns, table %.2f ns per value (%.1fx), %u bytes per table %s\n",
+        old_ns, new_ns, old_ns / new_ns, (unsigned)sizeof(table.duty), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// 2 writers and 3 readers on real threads: every read must be one complete write
+bool check_seqlock() {
+    typedef struct { uint32_t word[16]; } block_t;
+    const uint32_t writes = 1000000;
+    Seqlock<block_t> lock;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> reads(0), torn(0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t w = 0; w < 2; w++) {
+        threads.emplace_back([&lock, w, writes] {
+            block_t b;
+            for (uint32_t n = 1; n <= writes; n++) {
+                for (uint32_t &word : b.word) word = n << 1 | w;
+                lock.write(b);
+            }
+        });
+    }
+    for (int r = 0; r < 3; r++) {
+        threads.emplace_back([&lock, &done, &reads, &torn] {
+            block_t b;
+            uint32_t n = 0, bad = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                lock.read(b);
+                for (uint32_t word : b.word) bad += word != b.word[0];
+                n++;
+            }
+            reads += n;
+            torn += bad;
+        });
+    }
+    threads[0].join();
+    threads[1].join();
+    done = true;
+    for (size_t i = 2; i < threads.size(); i++) threads[i].join();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = torn == 0 && lock.version() == 2 * writes;
+    printf("seqlock: 2 writers, 3 readers, %u writes, %u reads in %.2f s, %u torn words %s\n",
+        lock.version(), reads.load(), s, torn.load(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main( int argc, char *argv[] ) {
+    double hours = argc > 1 ? atof(argv[1]) : 3;
+    sim_record(argc > 2 ? argv[2] : NULL, argc > 3 ? argv[3] : NULL);
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    setup_app();
+    health_led.limits(1, health_led.range() / 2);
+    health_led.begin();
+    button.begin();
+
+    scheduler.add("button",  task_button,  2, 0,  2);
+    scheduler.add("app",     task_app,    10, 1, 10);
+    scheduler.add("breathe", task_breathe, 20, 3, 20);
+
+    const uint32_t end_ms = hours * 3600 * 1000;
+    const uint32_t press_interval = 10 * 60 * 1000;
+    const uint32_t drag_interval = 7 * 60 * 1000;
+    uint32_t presses = 0, toggles = 0, drags = 0;
+    uint32_t next_press = press_interval, release = 0, next_drag = drag_interval;
+    bool power = get_power();
+
+    while (millis() < end_ms) {
+        uint32_t now = millis();
+
+        if (now >= next_press) {
+            press_button();
+            release = millis() + 300;
+            next_press += press_interval;
+            presses++;
+        }
+        if (release && now >= release) {
+            release_button();
+            release = 0;
+        }
+        if (now >= next_drag) {
+            for (int i = 0; i < 50; i++) {
+                app_value(LED_R, (drags * 137 + i * 20) % 1001);
+                run_ms(20);
+            }
+            next_drag += drag_interval;
+            drags++;
+        }
+
+        run_ms(1);
+
+        if (get_power() != power) {
+            power = get_power();
+            toggles++;
+        }
+    }
+
+    sim_close();
+
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    printf("simulated %.2f h in %.2f s (%.0fx real time)\n", hours, wall_s, hours * 3600 / wall_s);
+    printf("button: %u presses, %u toggles\n", presses, toggles);
+    printf("sliders: %u drags, %u flash writes, %u bytes\n", drags, sim_pref_writes(), sim_pref_bytes());
+    printf("state: %u saves, estimated flash wear %u ppm\n", get_saves(), get_wear_ppm());
+    printf("pwm: %u output changes\n", sim_pwm_changes());
+    for (size_t i = 0; i < scheduler.count(); i++) {
+        printf("task %-8s runs %u missed %u\n", scheduler.name(i), scheduler.runs(i), scheduler.missed(i));
+    }
+
+    bool ok = check_strip(300, STRIP_GRB) && check_strip(300, STRIP_GRBW) && check_waves() && check_dither() && check_stagger() && check_power() && check_button()
+        && check_commands() && check_influx() && check_seqlock() && check_gamma() && check_template();
+    bench_effects(300, STRIP_GRB);
+
+    return ok ? 0 : 1;
+}
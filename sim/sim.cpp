@@ -0,0 +1,357 @@
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <sim.h>
+
+#include <malloc.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+static uint64_t now_us = 0;
+static int inputs[256];
+static bool inputs_init = false;
+
+typedef struct { uint64_t us; uint8_t pin; uint32_t duty; } sample_t;
+
+static std::vector<sample_t> samples;
+static std::map<uint8_t, uint32_t> outputs;  // current duty per pin
+static const char *csv_file = NULL;
+static const char *vcd_file = NULL;
+static uint32_t pwm_changes = 0;
+
+static std::map<std::string, std::vector<uint8_t>> nvs;
+static uint32_t pref_writes = 0;
+static uint32_t pref_bytes = 0;
+
+
+// Virtual clock, or the host clock for the web build
+
+static bool realtime = false;
+static std::chrono::steady_clock::time_point realtime_start;
+
+void sim_realtime() {
+    realtime = true;
+    realtime_start = std::chrono::steady_clock::now();
+}
+
+void sim_advance( uint32_t ms ) { now_us += (uint64_t)ms * 1000; }
+
+uint64_t sim_time_us() {
+    if (!realtime) return now_us;
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - realtime_start).count();
+}
+
+uint32_t millis() { return (uint32_t)(sim_time_us() / 1000); }
+uint32_t micros() { return (uint32_t)sim_time_us(); }
+
+void delay( uint32_t ms ) {
+    if (realtime) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    else sim_advance(ms);
+}
+
+long map( long x, long in_min, long in_max, long out_min, long out_max ) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+char *itoa( int value, char *str, int base ) {
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    char buf[34];
+    char *p = buf + sizeof(buf);
+    unsigned u = (value < 0 && base == 10) ? -(unsigned)value : (unsigned)value;
+    *--p = '\0';
+    do {
+        *--p = digits[u % base];
+        u /= base;
+    } while (u);
+    if (value < 0 && base == 10) *--p = '-';
+    return strcpy(str, p);
+}
+
+void configTime( long gmtOffset_sec, int daylightOffset_sec, const char *server1 ) {}
+
+
+// Serial and ESP
+
+HardwareSerial Serial;
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    uint32_t free = (uint32_t)mallinfo2().fordblks;
+    if (free < _min_free) _min_free = free;
+    return free;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    getFreeHeap();
+    return _min_free;
+}
+
+void EspClass::restart() {
+    fflush(stdout);
+    exit(0);
+}
+
+
+// Gpio
+
+void sim_input( uint8_t pin, int level ) {
+    if (!inputs_init) {
+        for (auto &i : inputs) i = HIGH;  // all pulled up
+        inputs_init = true;
+    }
+    inputs[pin] = level;
+}
+
+void pinMode( uint8_t pin, uint8_t mode ) {}
+
+int digitalRead( uint8_t pin ) {
+    return inputs_init ? inputs[pin] : HIGH;
+}
+
+void digitalWrite( uint8_t pin, uint8_t val ) {}
+
+
+// Pwm outputs
+
+static void record( uint8_t pin, uint32_t duty ) {
+    auto out = outputs.find(pin);
+    if (out != outputs.end() && out->second == duty) return;
+    outputs[pin] = duty;
+    pwm_changes++;
+    if (csv_file || vcd_file) {
+        samples.push_back({ sim_time_us(), pin, duty });
+    }
+}
+
+bool ledcAttach( uint8_t pin, uint32_t freq, uint8_t resolution ) { record(pin, 0); return true; }
+bool ledcDetach( uint8_t pin ) { return true; }
+bool ledcWrite( uint8_t pin, uint32_t duty ) { record(pin, duty); return true; }
+void analogWrite( uint8_t pin, int value ) { record(pin, value); }
+void analogWriteRange( uint32_t range ) {}
+
+void rgbLedWrite( uint8_t pin, uint8_t red, uint8_t green, uint8_t blue ) {
+    record(pin, (red << 16) | (green << 8) | blue);
+}
+
+uint32_t sim_pwm_changes() { return pwm_changes; }
+
+
+// Waveform export
+
+void sim_record( const char *csv_path, const char *vcd_path ) {
+    csv_file = csv_path;
+    vcd_file = vcd_path;
+}
+
+void sim_close() {
+    if (csv_file) {
+        FILE *f = fopen(csv_file, "w");
+        if (f) {
+            fprintf(f, "time_us,pin,duty\n");
+            for (auto &s : samples) {
+                fprintf(f, "%llu,%u,%u\n", (unsigned long long)s.us, s.pin, s.duty);
+            }
+            fclose(f);
+        }
+    }
+
+    if (vcd_file) {
+        FILE *f = fopen(vcd_file, "w");
+        if (f) {
+            std::set<uint8_t> pins;
+            for (auto &s : samples) pins.insert(s.pin);
+            fprintf(f, "$timescale 1us $end\n$scope module sliderpwm $end\n");
+            for (uint8_t pin : pins) {
+                fprintf(f, "$var integer 32 p%u pwm%u $end\n", pin, pin);
+            }
+            fprintf(f, "$upscope $end\n$enddefinitions $end\n");
+            uint64_t t = UINT64_MAX;
+            for (auto &s : samples) {
+                if (s.us != t) {
+                    t = s.us;
+                    fprintf(f, "#%llu\n", (unsigned long long)t);
+                }
+                fprintf(f, "b");
+                for (int bit = 31; bit >= 0; bit--) {
+                    if ((s.duty >> bit) || bit == 0) fputc((s.duty >> bit) & 1 ? '1' : '0', f);
+                }
+                fprintf(f, " p%u\n", s.pin);
+            }
+            fclose(f);
+        }
+    }
+}
+
+
+// Preferences
+
+bool Preferences::begin( const char *name, bool readOnly, const char *partition ) {
+    _ns = std::string(name) + "/";
+    return true;
+}
+
+void Preferences::end() {}
+
+bool Preferences::isKey( const char *key ) { return nvs.count(_ns + key) > 0; }
+bool Preferences::remove( const char *key ) { return nvs.erase(_ns + key) > 0; }
+
+size_t Preferences::put( const char *key, const void *value, size_t len ) {
+    const uint8_t *v = (const uint8_t *)value;
+    nvs[_ns + key] = std::vector<uint8_t>(v, v + len);
+    pref_writes++;
+    pref_bytes += len;
+    return len;
+}
+
+bool Preferences::get( const char *key, void *value, size_t len ) {
+    auto it = nvs.find(_ns + key);
+    if (it == nvs.end() || it->second.size() != len) return false;
+    memcpy(value, it->second.data(), len);
+    return true;
+}
+
+size_t Preferences::putBool( const char *key, bool value ) { uint8_t v = value; return put(key, &v, 1); }
+size_t Preferences::putInt( const char *key, int32_t value ) { return put(key, &value, sizeof(value)); }
+size_t Preferences::putUInt( const char *key, uint32_t value ) { return put(key, &value, sizeof(value)); }
+size_t Preferences::putBytes( const char *key, const void *value, size_t len ) { return put(key, value, len); }
+
+bool Preferences::getBool( const char *key, bool defaultValue ) {
+    uint8_t v;
+    return get(key, &v, 1) ? v != 0 : defaultValue;
+}
+
+int32_t Preferences::getInt( const char *key, int32_t defaultValue ) {
+    int32_t v;
+    return get(key, &v, sizeof(v)) ? v : defaultValue;
+}
+
+uint32_t Preferences::getUInt( const char *key, uint32_t defaultValue ) {
+    uint32_t v;
+    return get(key, &v, sizeof(v)) ? v : defaultValue;
+}
+
+size_t Preferences::getBytesLength( const char *key ) {
+    auto it = nvs.find(_ns + key);
+    return it == nvs.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes( const char *key, void *buf, size_t maxLen ) {
+    auto it = nvs.find(_ns + key);
+    if (it == nvs.end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+uint32_t sim_pref_writes() { return pref_writes; }
+uint32_t sim_pref_bytes() { return pref_bytes; }
+
+
+// WiFi and HTTPClient over POSIX sockets (loopback stand-in servers)
+
+WiFiClass WiFi;
+
+bool WiFiClient::connect( const char *host, uint16_t port, uint32_t timeout_ms ) {
+    stop();
+    struct addrinfo hints = {}, *res = NULL;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &res) != 0) return false;
+    _fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (_fd >= 0) {
+        struct timeval tv = { (time_t)(timeout_ms / 1000), (suseconds_t)(timeout_ms % 1000 * 1000) };
+        setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(_fd, res->ai_addr, res->ai_addrlen) != 0) stop();
+    }
+    freeaddrinfo(res);
+    return _fd >= 0;
+}
+
+void WiFiClient::stop() {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+}
+
+bool WiFiClient::write( const void *data, size_t len ) {
+    const char *p = (const char *)data;
+    while (len) {
+        ssize_t n = send(_fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+int WiFiClient::read( void *buf, size_t len ) {
+    ssize_t n = recv(_fd, buf, len, 0);
+    return n < 0 ? -1 : (int)n;
+}
+
+bool HTTPClient::begin( WiFiClient &client, const char *host, uint16_t port, const char *uri ) {
+    _client = &client;
+    _host = host;
+    _port = port;
+    _uri = uri;
+    _size = -1;
+    _body.clear();
+    return true;
+}
+
+int HTTPClient::POST( const uint8_t *payload, size_t len ) {
+    for (int attempt = 0; attempt < 2; attempt++) {  // a kept connection may have been closed by the server
+        bool reused = _client->connected();
+        if (!reused) {
+            if (!_client->connect(_host.c_str(), _port, _timeout_ms)) return -1;
+            _connects++;
+        }
+        char head[512];
+        int n = snprintf(head, sizeof(head), "POST %s HTTP/1.1\r\nHost: %s:%u\r\nUser-Agent: %s\r\n"
+            "Connection: %s\r\nContent-Length: %u\r\n\r\n", _uri.c_str(), _host.c_str(), _port, _agent.c_str(),
+            _reuse ? "keep-alive" : "close", (unsigned)len);
+        std::string response;
+        char buf[1024];
+        int got = 0;
+        std::string request(head, n);
+        request.append((const char *)payload, len);
+        if (_client->write(request.data(), request.size())) {
+            // status line and headers, then Content-Length bytes of body
+            size_t end;
+            while ((end = response.find("\r\n\r\n")) == std::string::npos && (got = _client->read(buf, sizeof(buf))) > 0) {
+                response.append(buf, got);
+            }
+            if (end != std::string::npos) {
+                int status = 0;
+                sscanf(response.c_str(), "HTTP/1.%*d %d", &status);
+                const char *cl = strcasestr(response.c_str(), "\r\nContent-Length:");
+                _size = (cl && cl < response.c_str() + end) ? atoi(cl + 17) : 0;
+                _body = response.substr(end + 4);
+                while ((int)_body.size() < _size && (got = _client->read(buf, sizeof(buf))) > 0) _body.append(buf, got);
+                if (strcasestr(response.c_str(), "\r\nConnection: close")) _client->stop();
+                return status;
+            }
+        }
+        _client->stop();
+        if (!reused) return -1;
+    }
+    return -1;
+}
+
+void HTTPClient::end() {
+    if (!_reuse && _client) _client->stop();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Native simulation of the firmware logic
+// A virtual clock drives millis()/micros(), gpio inputs are scripted
+// and every pwm output change is recorded for CSV and VCD export.
+
+#include <stdint.h>
+
+void sim_advance( uint32_t ms );   // move the virtual clock forward
+uint64_t sim_time_us();            // current virtual time
+void sim_realtime();               // use the host clock from now on, delay() sleeps (web build)
+
+void sim_input( uint8_t pin, int level );  // level digitalRead() returns from now on
+
+// record pwm changes, files are written by sim_close(), NULL to skip
+void sim_record( const char *csv_path, const char *vcd_path );
+void sim_close();
+
+uint32_t sim_pwm_changes();        // number of pwm output changes
+uint32_t sim_pref_writes();        // number of Preferences put calls
+uint32_t sim_pref_bytes();         // bytes written by Preferences put calls
@@ -0,0 +1,588 @@
+#include <ESPAsyncWebServer.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#define WEB_CHUNK 1436  // filler buffer of chunked responses: about one tcp segment
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC11B85"
+
+struct AsyncWebConnection {
+    int fd;                        // -1 once closed
+    std::string in;                // received, not yet handled
+    std::string out;               // not yet sent
+    bool close_after;              // close once out is sent
+    AsyncWebSocket *socket;        // set by the websocket upgrade
+    AsyncWebSocketClient *client;
+};
+
+static std::vector<AsyncWebServer *> servers;
+
+
+// Socket output, the rest is sent when the socket is writable again
+
+static void flush( AsyncWebConnection *conn ) {
+    while (conn->fd >= 0 && !conn->out.empty()) {
+        ssize_t n = send(conn->fd, conn->out.data(), conn->out.size(), MSG_NOSIGNAL);
+        if (n <= 0) break;  // full, errors show up as closed on the next read
+        conn->out.erase(0, n);
+    }
+}
+
+static void write( AsyncWebConnection *conn, const std::string &data ) {
+    conn->out += data;
+    flush(conn);
+}
+
+
+// Encoding helpers
+
+static std::string url_decode( const std::string &s ) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '+') out += ' ';
+        else if (s[i] == '%' && i + 2 < s.size() && isxdigit((unsigned char)s[i + 1]) && isxdigit((unsigned char)s[i + 2])) {
+            out += (char)strtol(s.substr(i + 1, 2).c_str(), NULL, 16);
+            i += 2;
+        }
+        else out += s[i];
+    }
+    return out;
+}
+
+static void parse_form( std::vector<AsyncWebParameter> &params, const std::string &form, bool post ) {
+    size_t pos = 0;
+    while (pos < form.size()) {
+        size_t end = form.find('&', pos);
+        if (end == std::string::npos) end = form.size();
+        std::string pair = form.substr(pos, end - pos);
+        if (!pair.empty()) {
+            size_t eq = pair.find('=');
+            std::string value = eq == std::string::npos ? "" : url_decode(pair.substr(eq + 1));
+            params.emplace_back(String(url_decode(pair.substr(0, eq))), String(value), post);
+        }
+        pos = end + 1;
+    }
+}
+
+// Quoted attribute of a header value, e.g. name of Content-Disposition: form-data; name="x"
+static std::string attribute( const std::string &header, const char *name ) {
+    std::string key = std::string(name) + "=\"";
+    size_t pos = header.find(key);
+    if (pos == std::string::npos) return "";
+    pos += key.size();
+    return header.substr(pos, header.find('"', pos) - pos);
+}
+
+static std::string sha1( const std::string &msg ) {
+    uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    std::string m = msg;
+    uint64_t bits = (uint64_t)msg.size() * 8;
+    m += (char)0x80;
+    while (m.size() % 64 != 56) m += (char)0;
+    for (int i = 7; i >= 0; i--) m += (char)(bits >> (8 * i));
+
+    for (size_t off = 0; off < m.size(); off += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t *p = (const uint8_t *)m.data() + off + 4 * i;
+            w[i] = (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            uint32_t x = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = x << 1 | x >> 31;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5a827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ed9eba1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+            else { f = b ^ c ^ d; k = 0xca62c1d6; }
+            uint32_t t = (a << 5 | a >> 27) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = b << 30 | b >> 2;
+            b = a;
+            a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    std::string digest;
+    for (uint32_t v : h) {
+        for (int i = 3; i >= 0; i--) digest += (char)(v >> (8 * i));
+    }
+    return digest;
+}
+
+static std::string base64( const std::string &in ) {
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < in.size(); i += 3) {
+        uint32_t v = (uint8_t)in[i] << 16;
+        if (i + 1 < in.size()) v |= (uint8_t)in[i + 1] << 8;
+        if (i + 2 < in.size()) v |= (uint8_t)in[i + 2];
+        out += digits[v >> 18];
+        out += digits[(v >> 12) & 0x3f];
+        out += i + 1 < in.size() ? digits[(v >> 6) & 0x3f] : '=';
+        out += i + 2 < in.size() ? digits[v & 0x3f] : '=';
+    }
+    return out;
+}
+
+// Unmasked final frame from the server
+static std::string ws_encode( uint8_t opcode, const uint8_t *data, size_t len ) {
+    std::string frame(1, (char)(0x80 | opcode));
+    if (len < 126) {
+        frame += (char)len;
+    }
+    else if (len < 65536) {
+        frame += (char)126;
+        frame += (char)(len >> 8);
+        frame += (char)len;
+    }
+    else {
+        frame += (char)127;
+        for (int i = 7; i >= 0; i--) frame += (char)((uint64_t)len >> (8 * i));
+    }
+    frame.append((const char *)data, len);
+    return frame;
+}
+
+static const char *reason( int code ) {
+    switch (code) {
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        default: return "";
+    }
+}
+
+
+// Request and response
+
+bool AsyncWebServerRequest::hasParam( const char *name, bool post ) const {
+    for (const AsyncWebParameter &p : _params) {
+        if (p.isPost() == post && p.name().equals(name)) return true;
+    }
+    return false;
+}
+
+String AsyncWebServerRequest::arg( const char *name ) const {
+    for (const AsyncWebParameter &p : _params) {
+        if (p.name().equals(name)) return p.value();
+    }
+    return String();
+}
+
+bool AsyncWebServerRequest::hasHeader( const char *name ) const {
+    for (const auto &h : _headers) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return true;
+    }
+    return false;
+}
+
+String AsyncWebServerRequest::header( const char *name ) const {
+    for (const auto &h : _headers) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return String(h.second);
+    }
+    return String();
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse( int code, const char *type, const char *content ) {
+    AsyncWebServerResponse *response = new AsyncWebServerResponse(code, type);
+    response->_body = content ? content : "";
+    return response;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse( int code, const char *type, const uint8_t *data, size_t len ) {
+    AsyncWebServerResponse *response = new AsyncWebServerResponse(code, type);
+    response->_body.assign((const char *)data, len);
+    return response;
+}
+
+// Like the library: path.gz with Content-Encoding gzip if there is no plain file
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse( fs::FS &fs, const String &path, const char *type ) {
+    std::string name = path.c_str();
+    bool gzip = !fs.exists(name.c_str()) && fs.exists((name + ".gz").c_str());
+    if (gzip) name += ".gz";
+    fs::File file = fs.open(name.c_str(), "r");
+    if (!file || file.isDirectory()) return beginResponse(404);
+
+    AsyncWebServerResponse *response = new AsyncWebServerResponse(200, type);
+    response->_body.resize(file.size());
+    response->_body.resize(file.read((uint8_t *)&response->_body[0], response->_body.size()));
+    if (gzip) response->addHeader("Content-Encoding", "gzip");
+    return response;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse( const char *type, AwsResponseFiller filler ) {
+    AsyncWebServerResponse *response = new AsyncWebServerResponse(200, type);
+    response->_filler = filler;
+    return response;
+}
+
+void AsyncWebServerRequest::send( AsyncWebServerResponse *response ) {
+    if (_response) delete response;
+    else _response.reset(response);
+}
+
+void AsyncWebServerRequest::redirect( const char *url ) {
+    AsyncWebServerResponse *response = beginResponse(302);
+    response->addHeader("Location", url);
+    send(response);
+}
+
+// The device calls the filler whenever the tcp window has room, here all chunks are made at once
+std::string AsyncWebServerRequest::serialize( bool keep_alive ) const {
+    const AsyncWebServerResponse &r = *_response;
+    char line[64];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", r._code, reason(r._code));
+    std::string out = line;
+    if (!r._type.empty()) out += "Content-Type: " + r._type + "\r\n";
+    for (const auto &h : r._headers) {
+        if (strcasecmp(h.first.c_str(), "Connection") != 0) out += h.first + ": " + h.second + "\r\n";
+    }
+    bool bodyless = r._code < 200 || r._code == 204 || r._code == 304;
+    if (!bodyless) {
+        if (r._filler) out += "Transfer-Encoding: chunked\r\n";
+        else out += "Content-Length: " + std::to_string(r._body.size()) + "\r\n";
+    }
+    if (!keep_alive) out += "Connection: close\r\n";
+    out += "\r\n";
+    if (bodyless) return out;
+
+    if (r._filler) {
+        uint8_t buf[WEB_CHUNK];
+        size_t index = 0, len;
+        while ((len = r._filler(buf, sizeof(buf), index)) > 0) {
+            snprintf(line, sizeof(line), "%zx\r\n", len);
+            out += line;
+            out.append((const char *)buf, len);
+            out += "\r\n";
+            index += len;
+        }
+        out += "0\r\n\r\n";
+    }
+    else {
+        out += r._body;
+    }
+    return out;
+}
+
+
+// Websocket
+
+void AsyncWebSocketClient::binary( const uint8_t *data, size_t len ) {
+    if (!_closing) write(_conn, ws_encode(WS_BINARY, data, len));
+}
+
+void AsyncWebSocketClient::close() {
+    static const uint8_t normal[] = { 0x03, 0xe8 };  // status 1000
+    if (_closing) return;
+    write(_conn, ws_encode(WS_DISCONNECT, normal, sizeof(normal)));
+    _closing = true;
+}
+
+size_t AsyncWebSocket::count() const {
+    return std::count_if(_clients.begin(), _clients.end(), [](const AsyncWebSocketClient *c) { return !c->_closing; });
+}
+
+void AsyncWebSocket::cleanupClients( uint16_t maxClients ) {
+    size_t open = count();
+    for (AsyncWebSocketClient *c : _clients) {
+        if (open <= maxClients) break;
+        if (!c->_closing) {
+            c->close();
+            open--;
+        }
+    }
+}
+
+void AsyncWebSocket::binaryAll( const uint8_t *data, size_t len ) {
+    for (AsyncWebSocketClient *c : _clients) c->binary(data, len);
+}
+
+
+// Server
+
+AsyncWebServer::AsyncWebServer( uint16_t port ) : _port(port), _fd(-1) {}
+
+AsyncWebServer::~AsyncWebServer() {
+    for (auto &conn : _conns) {
+        if (conn->fd >= 0) disconnect(conn.get());
+    }
+    if (_fd >= 0) close(_fd);
+    servers.erase(std::remove(servers.begin(), servers.end(), this), servers.end());
+}
+
+void AsyncWebServer::begin() {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(_port);
+    int one = 1;
+
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(_fd, 16) != 0) {
+        fprintf(stderr, "AsyncWebServer: port %u: %s\n", _port, strerror(errno));
+        close(_fd);
+        _fd = -1;
+        return;
+    }
+    fcntl(_fd, F_SETFL, O_NONBLOCK);
+    servers.push_back(this);
+}
+
+void AsyncWebServer::addHandler( AsyncWebHandler *handler ) {
+    AsyncWebSocket *socket = dynamic_cast<AsyncWebSocket *>(handler);
+    if (socket) _sockets.push_back(socket);
+}
+
+void AsyncWebServer::on( const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+        ArUploadHandlerFunction onUpload ) {
+    _routes.push_back({ uri, method, onRequest, onUpload });
+}
+
+bool AsyncWebServer::upgrade( AsyncWebConnection *conn, AsyncWebServerRequest &request ) {
+    for (AsyncWebSocket *ws : _sockets) {
+        if (ws->_url != request._url.c_str()) continue;
+
+        std::string key = request.header("Sec-WebSocket-Key").c_str();
+        write(conn, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + base64(sha1(key + WS_GUID)) + "\r\n\r\n");
+        conn->socket = ws;
+        conn->client = new AsyncWebSocketClient(conn, ws->_next_id++);
+        ws->_clients.push_back(conn->client);
+        if (ws->_handler) ws->_handler(ws, conn->client, WS_EVT_CONNECT, NULL, NULL, 0);
+        return true;
+    }
+    return false;
+}
+
+bool AsyncWebServer::handle_http( AsyncWebConnection *conn ) {
+    size_t head_end = conn->in.find("\r\n\r\n");
+    if (head_end == std::string::npos) return false;
+
+    AsyncWebServerRequest request(conn);
+    std::string head = conn->in.substr(0, head_end);
+    size_t line_end = std::min(head.find("\r\n"), head.size());
+    std::string line = head.substr(0, line_end);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.find(' ', sp1 + 1);
+    std::string method = line.substr(0, sp1);
+    std::string target = sp1 == std::string::npos ? "/" : line.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string version = sp2 == std::string::npos ? "" : line.substr(sp2 + 1);
+
+    for (size_t pos = line_end + 2; pos < head.size(); ) {
+        size_t end = std::min(head.find("\r\n", pos), head.size());
+        std::string h = head.substr(pos, end - pos);
+        size_t colon = h.find(':');
+        if (colon != std::string::npos) {
+            size_t value = h.find_first_not_of(' ', colon + 1);
+            request._headers.emplace_back(h.substr(0, colon), value == std::string::npos ? "" : h.substr(value));
+        }
+        pos = end + 2;
+    }
+
+    size_t len = request.hasHeader("Content-Length") ? request.header("Content-Length").toInt() : 0;
+    if (conn->in.size() < head_end + 4 + len) return false;
+    std::string body = conn->in.substr(head_end + 4, len);
+    conn->in.erase(0, head_end + 4 + len);
+
+    static const char *methods[] = { "GET", "POST", "DELETE", "PUT", "PATCH", "HEAD", "OPTIONS" };
+    for (size_t i = 0; i < sizeof(methods) / sizeof(*methods); i++) {
+        if (method == methods[i]) request._method = 1 << i;
+    }
+    size_t query = target.find('?');
+    request._url = String(target.substr(0, query));
+    if (query != std::string::npos) parse_form(request._params, target.substr(query + 1), false);
+
+    String connection = request.header("Connection");
+    bool keep_alive = version == "HTTP/1.1" ? !connection.equalsIgnoreCase("close") : connection.equalsIgnoreCase("keep-alive");
+
+    if (request.header("Upgrade").equalsIgnoreCase("websocket") && upgrade(conn, request)) return true;
+
+    // form fields are post parameters, file parts go to the upload handler in one piece
+    std::vector<std::pair<std::string, std::string>> files;
+    std::string type = request.header("Content-Type").c_str();
+    if (type.compare(0, 33, "application/x-www-form-urlencoded") == 0) {
+        parse_form(request._params, body, true);
+    }
+    else if (type.compare(0, 19, "multipart/form-data") == 0) {
+        size_t boundary = type.find("boundary=");
+        std::string delimiter = "--" + (boundary == std::string::npos ? "" : type.substr(boundary + 9));
+        size_t pos = body.find(delimiter);
+        while (pos != std::string::npos && body.compare(pos + delimiter.size(), 2, "--") != 0) {
+            size_t part = pos + delimiter.size() + 2;
+            size_t data = body.find("\r\n\r\n", part);
+            size_t next = body.find("\r\n" + delimiter, part);
+            if (data == std::string::npos || next == std::string::npos || data > next) break;
+            std::string headers = body.substr(part, data - part);
+            std::string name = attribute(headers, "name");
+            std::string value = body.substr(data + 4, next - data - 4);
+            if (headers.find("filename=\"") != std::string::npos) files.emplace_back(attribute(headers, "filename"), value);
+            else request._params.emplace_back(String(name), String(value), true);
+            pos = next + 2;
+        }
+    }
+
+    // like the library: first route with the same uri or a parent of it and a matching method
+    const route_t *route = NULL;
+    std::string url = request._url.c_str();
+    for (const route_t &r : _routes) {
+        if ((r.method & request._method) && (r.uri == url || url.compare(0, r.uri.size() + 1, r.uri + "/") == 0)) {
+            route = &r;
+            break;
+        }
+    }
+    if (route) {
+        if (route->upload) {
+            for (auto &f : files) {
+                route->upload(&request, String(f.first), 0, (uint8_t *)&f.second[0], f.second.size(), true);
+            }
+        }
+        route->request(&request);
+    }
+    else if (_not_found) {
+        _not_found(&request);
+    }
+    if (!request._response) request.send(404);
+
+    for (const auto &h : request._response->_headers) {
+        if (strcasecmp(h.first.c_str(), "Connection") == 0 && strcasecmp(h.second.c_str(), "close") == 0) keep_alive = false;
+    }
+    write(conn, request.serialize(keep_alive));
+    if (!keep_alive) conn->close_after = true;
+    return true;
+}
+
+bool AsyncWebServer::handle_frame( AsyncWebConnection *conn ) {
+    const std::string &in = conn->in;
+    if (in.size() < 2) return false;
+
+    AwsFrameInfo info = {};
+    info.final = (uint8_t)in[0] >> 7;
+    info.opcode = in[0] & 0x0f;
+    info.message_opcode = info.opcode;
+    info.masked = (uint8_t)in[1] >> 7;
+    uint64_t len = in[1] & 0x7f;
+    size_t pos = 2;
+    if (len == 126) {
+        if (in.size() < 4) return false;
+        len = (uint8_t)in[2] << 8 | (uint8_t)in[3];
+        pos = 4;
+    }
+    else if (len == 127) {
+        if (in.size() < 10) return false;
+        len = 0;
+        for (int i = 0; i < 8; i++) len = len << 8 | (uint8_t)in[2 + i];
+        pos = 10;
+    }
+    if (info.masked) {
+        if (in.size() < pos + 4) return false;
+        memcpy(info.mask, in.data() + pos, 4);
+        pos += 4;
+    }
+    if (in.size() < pos + len) return false;
+
+    info.len = len;
+    std::string data = in.substr(pos, len);
+    if (info.masked) {
+        for (size_t i = 0; i < len; i++) data[i] ^= info.mask[i & 3];
+    }
+    conn->in.erase(0, pos + len);
+
+    AsyncWebSocket *ws = conn->socket;
+    AsyncWebSocketClient *client = conn->client;
+    switch (info.opcode) {
+        case WS_DISCONNECT:
+            if (!client->_closing) {
+                write(conn, ws_encode(WS_DISCONNECT, (const uint8_t *)data.data(), std::min<size_t>(len, 2)));
+                client->_closing = true;
+            }
+            conn->close_after = true;
+            break;
+        case WS_PING:
+            write(conn, ws_encode(WS_PONG, (const uint8_t *)data.data(), len));
+            break;
+        case WS_PONG:
+            if (ws->_handler) ws->_handler(ws, client, WS_EVT_PONG, NULL, (uint8_t *)&data[0], len);
+            break;
+        default:
+            if (ws->_handler) ws->_handler(ws, client, WS_EVT_DATA, &info, (uint8_t *)&data[0], len);
+    }
+    return true;
+}
+
+void AsyncWebServer::disconnect( AsyncWebConnection *conn ) {
+    if (conn->client) {
+        AsyncWebSocket *ws = conn->socket;
+        ws->_clients.erase(std::remove(ws->_clients.begin(), ws->_clients.end(), conn->client), ws->_clients.end());
+        if (ws->_handler) ws->_handler(ws, conn->client, WS_EVT_DISCONNECT, NULL, NULL, 0);
+        delete conn->client;
+        conn->client = NULL;
+    }
+    close(conn->fd);
+    conn->fd = -1;
+}
+
+void AsyncWebServer::poll( int timeout_ms ) {
+    std::vector<struct pollfd> fds;
+    fds.push_back({ _fd, POLLIN, 0 });
+    for (auto &conn : _conns) {
+        fds.push_back({ conn->fd, (short)(POLLIN | (conn->out.empty() ? 0 : POLLOUT)), 0 });
+    }
+    if (::poll(fds.data(), fds.size(), timeout_ms) <= 0) return;
+
+    for (size_t i = 1; i < fds.size(); i++) {
+        AsyncWebConnection *conn = _conns[i - 1].get();
+        if (conn->fd < 0) continue;  // closed while handling another one
+        if (fds[i].revents & POLLOUT) flush(conn);
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+            char buf[4096];
+            ssize_t n;
+            while ((n = recv(conn->fd, buf, sizeof(buf), 0)) > 0) conn->in.append(buf, n);
+            bool closed = n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+            while (!conn->close_after && (conn->socket ? handle_frame(conn) : handle_http(conn)))
+                ;
+            if (closed) disconnect(conn);
+        }
+        if (conn->fd >= 0 && conn->close_after && conn->out.empty()) disconnect(conn);
+    }
+    _conns.erase(std::remove_if(_conns.begin(), _conns.end(),
+        [](const std::unique_ptr<AsyncWebConnection> &conn) { return conn->fd < 0; }), _conns.end());
+
+    if (fds[0].revents & POLLIN) {
+        int fd;
+        while ((fd = accept(_fd, NULL, NULL)) >= 0) {
+            int one = 1;
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            _conns.emplace_back(new AsyncWebConnection{ fd, "", "", false, NULL, NULL });
+        }
+    }
+}
+
+void async_web_poll( int timeout_ms ) {
+    if (servers.empty()) {
+        ::poll(NULL, 0, timeout_ms);
+        return;
+    }
+    for (AsyncWebServer *server : servers) {
+        server->poll(server == servers.front() ? timeout_ms : 0);
+    }
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+// Stand-in for ESPAsyncWebServer in the native web build (see web.cpp)
+// HTTP/1.1 with keep-alive, urlencoded and multipart forms and RFC 6455 websockets
+// over POSIX sockets, with the request, response and websocket calls the firmware uses.
+// On the device the async_tcp task runs the handlers. Here async_web_poll() serves
+// all sockets from the loop thread between scheduler runs: the host build has no
+// FreeRTOS, so there is no AppLock that could serialize a second thread.
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef enum {
+    HTTP_GET     = 0b00000001,
+    HTTP_POST    = 0b00000010,
+    HTTP_DELETE  = 0b00000100,
+    HTTP_PUT     = 0b00001000,
+    HTTP_PATCH   = 0b00010000,
+    HTTP_HEAD    = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY     = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebSocket;
+struct AsyncWebConnection;  // socket of one client, see AsyncWebServer.cpp
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data,
+    size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+
+class AsyncWebParameter {
+    public:
+        AsyncWebParameter( const String &name, const String &value, bool post ) : _name(name), _value(value), _post(post) {}
+
+        const String &name() const { return _name; }
+        const String &value() const { return _value; }
+        bool isPost() const { return _post; }
+
+    private:
+        String _name;
+        String _value;
+        bool _post;
+};
+
+
+class AsyncWebServerResponse {
+    public:
+        void setCode( int code ) { _code = code; }
+        void addHeader( const char *name, const char *value ) { _headers.emplace_back(name, value); }
+
+    private:
+        friend class AsyncWebServer;
+        friend class AsyncWebServerRequest;
+
+        AsyncWebServerResponse( int code, const char *type ) : _code(code), _type(type ? type : "") {}
+
+        int _code;
+        std::string _type;
+        std::vector<std::pair<std::string, std::string>> _headers;
+        std::string _body;
+        AwsResponseFiller _filler;  // set: body is sent chunked
+};
+
+
+class AsyncWebServerRequest {
+    public:
+        WebRequestMethodComposite method() const { return _method; }
+        const String &url() const { return _url; }
+
+        size_t params() const { return _params.size(); }
+        const AsyncWebParameter *getParam( size_t i ) const { return i < _params.size() ? &_params[i] : NULL; }
+        bool hasParam( const char *name, bool post = false ) const;
+        String arg( const char *name ) const;  // query or form parameter, empty if missing
+
+        bool hasHeader( const char *name ) const;
+        String header( const char *name ) const;
+
+        AsyncWebServerResponse *beginResponse( int code, const char *type = "", const char *content = "" );
+        AsyncWebServerResponse *beginResponse( int code, const char *type, const uint8_t *data, size_t len );
+        AsyncWebServerResponse *beginResponse( fs::FS &fs, const String &path, const char *type );
+        AsyncWebServerResponse *beginChunkedResponse( const char *type, AwsResponseFiller filler );
+
+        void send( AsyncWebServerResponse *response );  // takes ownership, only the first response is sent
+        void send( int code, const char *type = "", const char *content = "" ) { send(beginResponse(code, type, content)); }
+        void redirect( const char *url );
+
+    private:
+        friend class AsyncWebServer;
+
+        AsyncWebServerRequest( AsyncWebConnection *conn ) : _conn(conn), _method(0) {}
+
+        std::string serialize( bool keep_alive ) const;  // status line, headers and body of the response
+
+        AsyncWebConnection *_conn;
+        WebRequestMethodComposite _method;
+        String _url;
+        std::vector<std::pair<std::string, std::string>> _headers;
+        std::vector<AsyncWebParameter> _params;
+        std::unique_ptr<AsyncWebServerResponse> _response;
+};
+
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PING, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
+
+typedef struct {
+    uint8_t message_opcode;  // of the first frame of a fragmented message
+    uint32_t num;            // frame number of a fragmented message
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;            // of the frame
+    uint8_t mask[4];
+    uint64_t index;          // of the data within the frame
+} AwsFrameInfo;
+
+
+class AsyncWebSocketClient {
+    public:
+        uint32_t id() const { return _id; }
+
+        void binary( const uint8_t *data, size_t len );
+        void close();  // sends a close frame, disconnects when the client answers
+
+    private:
+        friend class AsyncWebServer;
+        friend class AsyncWebSocket;
+
+        AsyncWebSocketClient( AsyncWebConnection *conn, uint32_t id ) : _conn(conn), _id(id), _closing(false) {}
+
+        AsyncWebConnection *_conn;
+        uint32_t _id;
+        bool _closing;
+};
+
+typedef std::function<void(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg,
+    uint8_t *data, size_t len)> AwsEventHandler;
+
+
+class AsyncWebHandler {
+    public:
+        virtual ~AsyncWebHandler() {}
+};
+
+class AsyncWebSocket : public AsyncWebHandler {
+    public:
+        explicit AsyncWebSocket( const char *url ) : _url(url), _next_id(1) {}
+
+        void onEvent( AwsEventHandler handler ) { _handler = handler; }
+
+        size_t count() const;  // connected clients, not counting the closing ones
+        void cleanupClients( uint16_t maxClients = 8 );  // close the oldest ones above maxClients
+        void binaryAll( const uint8_t *data, size_t len );
+
+    private:
+        friend class AsyncWebServer;
+
+        std::string _url;
+        AwsEventHandler _handler;
+        std::vector<AsyncWebSocketClient *> _clients;  // oldest first
+        uint32_t _next_id;
+};
+
+
+class AsyncWebServer {
+    public:
+        explicit AsyncWebServer( uint16_t port );
+        ~AsyncWebServer();
+
+        void begin();  // listens on localhost
+
+        void addHandler( AsyncWebHandler *handler );  // websockets
+        void on( const char *uri, ArRequestHandlerFunction onRequest ) { on(uri, HTTP_ANY, onRequest); }
+        void on( const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+            ArUploadHandlerFunction onUpload = nullptr );
+        void onNotFound( ArRequestHandlerFunction onRequest ) { _not_found = onRequest; }
+
+        void poll( int timeout_ms );  // accept, read, handle and write what the sockets allow
+
+    private:
+        struct route_t {
+            std::string uri;
+            WebRequestMethodComposite method;
+            ArRequestHandlerFunction request;
+            ArUploadHandlerFunction upload;
+        };
+
+        bool handle_http( AsyncWebConnection *conn );   // one request, false if incomplete
+        bool handle_frame( AsyncWebConnection *conn );  // one websocket frame, false if incomplete
+        bool upgrade( AsyncWebConnection *conn, AsyncWebServerRequest &request );
+        void disconnect( AsyncWebConnection *conn );
+
+        uint16_t _port;
+        int _fd;
+        std::vector<route_t> _routes;
+        std::vector<AsyncWebSocket *> _sockets;
+        ArRequestHandlerFunction _not_found;
+        std::vector<std::unique_ptr<AsyncWebConnection>> _conns;
+};
+
+// Serve all started servers, wait at most timeout_ms for socket activity
+void async_web_poll( int timeout_ms );
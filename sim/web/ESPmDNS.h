@@ -0,0 +1,13 @@
+#pragma once
+
+// Stand-in for mDNS in the native web build: nothing is announced, use localhost
+
+#include <stdint.h>
+
+class MDNSResponder {
+    public:
+        bool begin( const char *hostName ) { return true; }
+        void addService( const char *service, const char *proto, uint16_t port ) {}
+};
+
+extern MDNSResponder MDNS;
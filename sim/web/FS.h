@@ -0,0 +1,65 @@
+#pragma once
+
+// Stand-in for the Arduino FS in the native web build
+// Paths are read from a host directory, data/ of the project unless set with root()
+
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+
+namespace fs {
+
+class File {
+    public:
+        File( FILE *f = NULL, bool dir = false ) : _f(f, [](FILE *f) { if (f) fclose(f); }), _dir(dir) {}
+
+        operator bool() const { return _f || _dir; }
+        bool isDirectory() const { return _dir; }
+
+        size_t size() const {
+            struct stat st;
+            return (_f && fstat(fileno(_f.get()), &st) == 0) ? st.st_size : 0;
+        }
+
+        int available() { return _f ? (int)(size() - ftell(_f.get())) : 0; }
+        int read() { return _f ? fgetc(_f.get()) : -1; }
+        size_t read( uint8_t *buf, size_t len ) { return _f ? fread(buf, 1, len, _f.get()) : 0; }
+        void close() { _f.reset(); _dir = false; }
+
+    private:
+        std::shared_ptr<FILE> _f;
+        bool _dir;
+};
+
+class FS {
+    public:
+        FS() : _root("data") {}
+
+        void root( const char *dir ) { _root = dir; }  // host only
+
+        bool exists( const char *path ) {
+            struct stat st;
+            return stat(host_path(path).c_str(), &st) == 0;
+        }
+
+        File open( const char *path, const char *mode = "r" ) {
+            struct stat st;
+            std::string p = host_path(path);
+            if (stat(p.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) return File(NULL, true);
+            return File(fopen(p.c_str(), mode));
+        }
+
+    private:
+        std::string host_path( const char *path ) const { return _root + (*path == '/' ? "" : "/") + path; }
+
+        std::string _root;
+};
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
@@ -0,0 +1,30 @@
+#pragma once
+
+// Stand-in for PubSubClient in the native web build: there is no broker, connects fail
+
+#include <WiFi.h>
+
+#include <functional>
+
+#define MQTT_CONNECT_FAILED -2
+
+class PubSubClient {
+    public:
+        typedef std::function<void(char *topic, uint8_t *payload, unsigned int length)> callback_t;
+
+        explicit PubSubClient( WiFiClient &client ) {}
+
+        PubSubClient &setServer( const char *domain, uint16_t port ) { return *this; }
+        PubSubClient &setCallback( callback_t callback ) { return *this; }
+
+        bool connect( const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage ) {
+            return false;
+        }
+        bool connected() { return false; }
+        void disconnect() {}
+        int state() { return MQTT_CONNECT_FAILED; }
+
+        bool publish( const char *topic, const char *payload, bool retained = false ) { return false; }
+        bool subscribe( const char *topic ) { return false; }
+        bool loop() { return false; }
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+// Stand-in for SPIFFS in the native web build, see FS.h
+
+#include <FS.h>
+
+namespace fs {
+
+class SPIFFSFS : public FS {
+    public:
+        bool begin( bool formatOnFail = false ) { return true; }
+};
+
+}  // namespace fs
+
+extern fs::SPIFFSFS SPIFFS;
@@ -0,0 +1,33 @@
+#pragma once
+
+// Stand-in for the Syslog library in the native web build
+// Nothing is sent, the firmware writes each record to Serial (stdout) as well
+
+#include <WiFi.h>
+
+#define SYSLOG_PROTO_IETF 0
+#define SYSLOG_PROTO_BSD 1
+
+// priorities and facilities as in the library
+#define LOG_EMERG 0
+#define LOG_ALERT 1
+#define LOG_CRIT 2
+#define LOG_ERR 3
+#define LOG_WARNING 4
+#define LOG_NOTICE 5
+#define LOG_INFO 6
+#define LOG_DEBUG 7
+#define LOG_KERN (0 << 3)
+#define LOG_USER (1 << 3)
+
+class Syslog {
+    public:
+        Syslog( WiFiUDP &client, uint8_t protocol = SYSLOG_PROTO_IETF ) {}
+
+        Syslog &server( const char *server, uint16_t port ) { return *this; }
+        Syslog &deviceHostname( const char *deviceHostname ) { return *this; }
+        Syslog &appName( const char *appName ) { return *this; }
+        Syslog &defaultPriority( uint16_t pri ) { return *this; }
+
+        bool log( uint16_t pri, const char *message ) { return true; }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Stand-in for the OTA updater in the native web build
+// Images are counted and discarded, a successful update ends the process like a reboot
+
+#include <Arduino.h>
+
+class UpdateClass {
+    public:
+        UpdateClass() : _size(0), _written(0) {}
+
+        bool begin( size_t size ) { _size = size; _written = 0; return true; }
+        size_t write( uint8_t *data, size_t len ) { _written += len; return len; }
+        bool end( bool evenIfRemaining = false ) { return evenIfRemaining || _written == _size; }
+
+        bool hasError() const { return false; }
+        const char *errorString() const { return "No Error"; }
+        void printError( Print &out ) { out.println(errorString()); }
+
+    private:
+        size_t _size;
+        size_t _written;
+};
+
+extern UpdateClass Update;
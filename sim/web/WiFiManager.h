@@ -0,0 +1,13 @@
+#pragma once
+
+// Stand-in for WiFiManager in the native web build: the host network is always there
+
+#include <WiFi.h>
+#include <Update.h>  // like the library, which brings the updater for its portal
+
+class WiFiManager {
+    public:
+        void resetSettings() {}
+        void setConfigPortalTimeout( unsigned long seconds ) {}
+        bool autoConnect( const char *apName, const char *apPassword ) { return true; }
+};
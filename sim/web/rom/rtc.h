@@ -0,0 +1,5 @@
+#pragma once
+
+// Stand-in for the ESP32 rom reset reason in the native web build: always a power on
+
+static inline int rtc_get_reset_reason( int cpu ) { return 1; }  // POWERON_RESET
@@ -0,0 +1,33 @@
+/*
+Host build of the firmware web server, see env native_web in platformio.ini
+Runs setup() and loop() of src/main.cpp on the host clock with the stand-ins in
+this directory. The web routes and the /ws socket are served on localhost
+port WEBSERVER_PORT, static assets from the data/ directory (or the one given).
+pio run -e native_web && .pio/build/native_web/program [data dir]
+*/
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPmDNS.h>
+#include <SPIFFS.h>
+#include <Update.h>
+#include <sim.h>
+
+fs::SPIFFSFS SPIFFS;
+UpdateClass Update;
+MDNSResponder MDNS;
+
+void setup();
+void loop();
+
+int main( int argc, char **argv ) {
+    if (argc > 1) SPIFFS.root(argv[1]);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    sim_realtime();
+    setup();
+    for (;;) {
+        loop();
+        async_web_poll(1);  // returns early on socket activity
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Static file served from data/ (filesystem) or from flash (data != NULL, gzipped)
+typedef struct {
+    const char *url;
+    const char *type;
+    const char *etag;
+    const uint8_t *data;
+    size_t len;
+} asset_t;
+
+// Content hashes of the files in data/, defined by assets.py at build time
+// Fallbacks keep builds without the script working, but defeat caching of changed files
+
+#ifndef ASSET_HASH_BOOTSTRAP_MIN_CSS
+#define ASSET_HASH_BOOTSTRAP_MIN_CSS "0"
+#endif
+
+#ifndef ASSET_HASH_BOOTSTRAP_BUNDLE_MIN_JS
+#define ASSET_HASH_BOOTSTRAP_BUNDLE_MIN_JS "0"
+#endif
+
+#ifndef ASSET_HASH_JQUERY_MIN_JS
+#define ASSET_HASH_JQUERY_MIN_JS "0"
+#endif
+
+#ifndef ASSET_HASH_SLIDER_JS
+#define ASSET_HASH_SLIDER_JS "0"
+#endif
+
+// versioned urls, served as immutable
+#define ASSET_BOOTSTRAP_CSS "bootstrap.min.css?v=" ASSET_HASH_BOOTSTRAP_MIN_CSS
+#define ASSET_BOOTSTRAP_JS "bootstrap.bundle.min.js?v=" ASSET_HASH_BOOTSTRAP_BUNDLE_MIN_JS
+#define ASSET_JQUERY_JS "jquery.min.js?v=" ASSET_HASH_JQUERY_MIN_JS
+#define ASSET_SLIDER_JS "slider.js?v=" ASSET_HASH_SLIDER_JS
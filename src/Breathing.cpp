@@ -1,17 +1,15 @@
 #include <Breathing.h>
 
-#define PWM_FREQ 25000
+#include <Pwm.h>
 
-#ifndef PWMRANGE
-#define PWMRANGE 1023
-#endif
-
-#ifndef PWMBITS
-#define PWMBITS 10
+#if defined(ESP32) && __has_include(<esp_timer.h>)
+    #include <esp_timer.h>
+    #define BREATHING_TIMER
 #endif
 
 Breathing::Breathing(uint32_t interval_ms, uint8_t pwm_pin, bool inverted, uint8_t pwm_channel) :
-    _interval_ms(interval_ms), _pwm_pin(pwm_pin), _inverted(inverted), _pwm_channel(pwm_channel), _min_duty(0), _max_duty(PWMRANGE) {
+    _wave(WAVE_BREATHE, interval_ms, 0, PWMRANGE), _interval_ms(interval_ms), _min_duty(0), _max_duty(PWMRANGE),
+    _table(NULL), _shape(WAVE_BREATHE), _pwm_pin(pwm_pin), _inverted(inverted), _pwm_channel(pwm_channel), _timer(NULL) {
 }
 
 void Breathing::begin() {
@@ -21,28 +19,53 @@ void Breathing::begin() {
         analogWriteRange(PWMRANGE);
         pinMode(_pwm_pin, OUTPUT);
     #endif
-    _start = millis();
-    _prev_duty = PWMRANGE;
+    _wave.start(millis());
+    _prev_duty = PWMRANGE + 1;  // write on first update
+}
+
+void Breathing::tick( void *arg ) {
+    static_cast<Breathing *>(arg)->update();
 }
 
 void Breathing::handle() {
-    // map elapsed in breathing intervals
-    uint32_t now = millis();
-    uint32_t elapsed = now - _start;
-    while (elapsed > _interval_ms) {
-        _start += _interval_ms;
-        elapsed -= _interval_ms;
-    }
+    #if defined(BREATHING_TIMER)
+        if (!_timer) {
+            // callback runs in the esp_timer task, not in an isr, so ledcWrite() is fine
+            esp_timer_create_args_t args = {};
+            args.callback = tick;
+            args.arg = this;
+            args.dispatch_method = ESP_TIMER_TASK;
+            args.name = "breathing";
+            esp_timer_handle_t timer;
+            if (esp_timer_create(&args, &timer) != ESP_OK) {
+                update();
+                return;
+            }
+            _timer = timer;
+        }
+        if (!esp_timer_is_active(static_cast<esp_timer_handle_t>(_timer))) {
+            esp_timer_start_periodic(static_cast<esp_timer_handle_t>(_timer), BREATHING_TICK_MS * 1000);
+        }
+    #else
+        update();
+    #endif
+}
 
-    // map min brightness to max brightness twice in one breathe interval
-    uint32_t duty = (_max_duty - _min_duty) * elapsed * 2 / _interval_ms + _min_duty;
-    if (duty > _max_duty) {
-        // second range: breathe out aka get darker
-        duty = 2 * _max_duty - duty;
-    }
+void Breathing::stop() {
+    #if defined(BREATHING_TIMER)
+        if (_timer && esp_timer_is_active(static_cast<esp_timer_handle_t>(_timer))) {
+            esp_timer_stop(static_cast<esp_timer_handle_t>(_timer));
+        }
+    #endif
+}
 
-    duty = duty * duty / _max_duty;  // generally reduce lower brightness levels
+void Breathing::update() {
+    uint32_t now = millis();
+    _wave.period(_interval_ms, now);
+    _wave.limits(_min_duty, _max_duty);
+    _wave.shape(static_cast<wave_shape_t>(_shape), _table);
 
+    uint32_t duty = _wave.value(now);
     if (duty != _prev_duty) {
         // adjust pwm duty cycle
         _prev_duty = duty;
@@ -50,7 +73,7 @@ void Breathing::handle() {
             duty = PWMRANGE - duty;
         }
         #if defined(ESP32)
-            ledcWrite(_pwm_channel, duty);
+            ledcWrite(_pwm_pin, duty);
         #else
             analogWrite(_pwm_pin, duty);
         #endif
@@ -66,6 +89,11 @@ void Breathing::limits( uint32_t min_duty, uint32_t max_duty ) {
     _max_duty = max_duty;
 }
 
+void Breathing::shape( wave_shape_t shape, const uint16_t *table ) {
+    _table = table;
+    _shape = shape;
+}
+
 uint32_t Breathing::range() {
     return PWMRANGE;
 }
@@ -3,30 +3,48 @@
 
 #include <Arduino.h>
 
+#include <Waveform.h>
+
 /*
 Handle a breathing led (or whatever is connected to the pwm pin)
+The duty follows a Waveform (exponential breathing by default). On ESP32 a
+periodic esp_timer updates the pwm once handle() was called, so the led
+keeps breathing smoothly while loop() is blocked. Elsewhere handle() updates.
 */
+
+#ifndef BREATHING_TICK_MS
+#define BREATHING_TICK_MS 10
+#endif
+
 class Breathing {
     public:
         // Define the controlled hardware
         Breathing(uint32_t interval_ms, uint8_t pwm_pin, bool inverted = false, uint8_t pwm_channel = 0);
 
         void begin();   // init the hardware and start the interval
-        void handle();  // adjust the duty cycle if needed
+        void handle();  // adjust the duty cycle if needed, or start the update timer
+        void stop();    // stop the update timer, the duty stays where it is
 
         void interval( uint32_t interval_ms );  // set the duration of a breathing cycle
         void limits( uint32_t min_duty, uint32_t max_duty );  // set duty limits to control minimum and maximum brightness of a cycle
+        void shape( wave_shape_t shape, const uint16_t *table = NULL );  // waveform of a cycle, see Waveform.h
         uint32_t range();  // get the available duty range, might be needed to calculate limits
 
     private:
-        uint32_t _interval_ms;
+        void update();  // from handle() or the timer
+        static void tick( void *arg );
+
+        Waveform _wave;  // only touched by update()
+        volatile uint32_t _interval_ms;
+        volatile uint32_t _min_duty;
+        volatile uint32_t _max_duty;
+        const uint16_t *volatile _table;
+        volatile uint32_t _shape;
         uint8_t _pwm_pin;
         bool _inverted;
-        uint8_t _pwm_channel;
-        uint32_t _start;
+        uint8_t _pwm_channel;  // Arduino 2 api, ledc is addressed by pin now
         uint32_t _prev_duty;
-        uint32_t _min_duty;
-        uint32_t _max_duty;
+        void *_timer;
 };
 
 #endif
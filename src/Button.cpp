@@ -0,0 +1,158 @@
+#include <Button.h>
+
+#if defined(ESP32) && __has_include(<esp_timer.h>)
+    #include <esp_timer.h>
+    #define BUTTON_TIMER
+#endif
+
+// gesture states
+enum { IDLE, DOWN, UP, DOWN2, HELD };
+
+Button::Button(uint8_t pin) : _pin(pin), _timer(false), _level(false), _pressed(false), _state(IDLE), _count(0),
+    _edge_ms(0), _first_ms(0), _press_ms(0), _since_ms(0), _queue(), _head(0), _tail(0),
+    _events(0), _dropped(0), _latency_ms(0), _max_latency_ms(0), _max_wait_ms(0) {
+}
+
+void Button::begin() {
+    pinMode(_pin, INPUT_PULLUP);
+    _level = _pressed = digitalRead(_pin) == LOW;
+
+    #if defined(BUTTON_TIMER)
+        static esp_timer_handle_t handle = NULL;
+        if (handle) return;
+
+        esp_timer_create_args_t args = {};
+        args.callback = timer;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "button";
+        if (esp_timer_create(&args, &handle) != ESP_OK) {
+            handle = NULL;
+            return;  // handle() polls
+        }
+        attachInterruptArg(digitalPinToInterrupt(_pin), isr, this, CHANGE);
+        if (esp_timer_start_periodic(handle, BUTTON_TICK_MS * 1000) != ESP_OK) {
+            detachInterrupt(digitalPinToInterrupt(_pin));
+            esp_timer_delete(handle);
+            handle = NULL;
+            return;
+        }
+        _timer = true;
+    #endif
+}
+
+void Button::handle() {
+    if (_timer) return;
+
+    uint32_t now = millis();
+    bool level = digitalRead(_pin) == LOW;
+    if (level != _level) {
+        _level = level;
+        edge(now);
+    }
+    tick(now, level);
+}
+
+void Button::edge( uint32_t now ) {
+    if (now - _edge_ms >= BUTTON_DEBOUNCE_MS) _first_ms = now;
+    _edge_ms = now;
+}
+
+#if defined(BUTTON_TIMER)
+// same as edge(), but in iram
+void IRAM_ATTR Button::isr( void *arg ) {
+    Button *button = static_cast<Button *>(arg);
+    uint32_t now = millis();
+    if (now - button->_edge_ms >= BUTTON_DEBOUNCE_MS) button->_first_ms = now;
+    button->_edge_ms = now;
+}
+
+// runs in the esp_timer task: the only producer of events
+void Button::timer( void *arg ) {
+    Button *button = static_cast<Button *>(arg);
+    button->tick(millis(), digitalRead(button->_pin) == LOW);
+}
+#else
+void Button::isr( void * ) {}
+void Button::timer( void * ) {}
+#endif
+
+void Button::tick( uint32_t now, bool level ) {
+    if (level != _pressed && now - _edge_ms >= BUTTON_DEBOUNCE_MS) {
+        _pressed = level;
+        _since_ms = now;
+        if (_pressed) {
+            _press_ms = _first_ms;
+            emit(BUTTON_PRESS, now);
+            if (_state == UP) {
+                emit(BUTTON_DOUBLE, now);
+                _state = DOWN2;
+            }
+            else {
+                _state = DOWN;
+            }
+        }
+        else {
+            emit(BUTTON_RELEASE, now);
+            if (_state == DOWN) {
+                emit(BUTTON_CLICK, now);  // no waiting for a second click
+                _state = BUTTON_DOUBLE_MS ? UP : IDLE;
+            }
+            else {
+                _state = IDLE;
+            }
+        }
+    }
+
+    switch (_state) {
+        case DOWN:
+            if (now - _since_ms >= BUTTON_LONG_MS) {
+                _count = 0;
+                _since_ms = now;
+                _state = HELD;
+                emit(BUTTON_HOLD, now);
+            }
+            break;
+        case HELD:
+            if (now - _since_ms >= BUTTON_REPEAT_MS) {
+                _count++;
+                _since_ms += BUTTON_REPEAT_MS;
+                emit(BUTTON_REPEAT, now);
+            }
+            break;
+        case UP:
+            if (now - _since_ms >= BUTTON_DOUBLE_MS) _state = IDLE;  // no second press
+            break;
+    }
+}
+
+void Button::emit( uint8_t type, uint32_t now ) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= BUTTON_QUEUE) {
+        _dropped++;
+        return;
+    }
+    button_event_t &e = _queue[head & (BUTTON_QUEUE - 1)];
+    e.type = type;
+    e.reserved = 0;
+    e.count = _count;
+    e.press_ms = _press_ms;
+    e.ms = now;
+    _head.store(head + 1, std::memory_order_release);
+    _events++;
+}
+
+bool Button::event( button_event_t &e ) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) return false;
+    e = _queue[tail & (BUTTON_QUEUE - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+void Button::applied( const button_event_t &e ) {
+    uint32_t now = millis();
+    _latency_ms = now - e.press_ms;
+    if (_latency_ms > _max_latency_ms) _max_latency_ms = _latency_ms;
+    if (now - e.ms > _max_wait_ms) _max_wait_ms = now - e.ms;
+}
@@ -0,0 +1,96 @@
+#ifndef Button_h
+#define Button_h
+
+#include <Arduino.h>
+#include <atomic>
+
+/*
+Debounce a button on a gpio pin and detect gestures
+Pin is pulled up if released and pulled down if pressed.
+A level is accepted once the pin was stable for BUTTON_DEBOUNCE_MS.
+On ESP32 a gpio interrupt stamps the edges and an esp_timer samples the pin
+every BUTTON_TICK_MS, so presses are not missed or delayed while loop() is busy.
+Elsewhere handle() samples the pin, call it every BUTTON_TICK_MS.
+Gestures are queued as events (one producer, one consumer, lock free), read
+them from the loop with event(). A click is reported on release, so it acts
+right away. A second press within BUTTON_DOUBLE_MS is a double click on top of
+that click. A hold repeats every BUTTON_REPEAT_MS until the release.
+*/
+
+#ifndef BUTTON_TICK_MS
+#define BUTTON_TICK_MS 2
+#endif
+
+#ifndef BUTTON_DEBOUNCE_MS
+#define BUTTON_DEBOUNCE_MS 10  // bounces must have settled this long
+#endif
+
+#ifndef BUTTON_DOUBLE_MS
+#define BUTTON_DOUBLE_MS 250  // max gap to a second press, 0: no double clicks
+#endif
+
+#ifndef BUTTON_LONG_MS
+#define BUTTON_LONG_MS 500  // press becomes a hold
+#endif
+
+#ifndef BUTTON_REPEAT_MS
+#define BUTTON_REPEAT_MS 40  // repeat interval while holding
+#endif
+
+#define BUTTON_QUEUE 16  // events, power of 2
+
+typedef enum { BUTTON_PRESS, BUTTON_RELEASE, BUTTON_CLICK, BUTTON_DOUBLE, BUTTON_HOLD, BUTTON_REPEAT } button_event_type_t;
+
+typedef struct {
+    uint8_t type;       // button_event_type_t
+    uint8_t reserved;
+    uint16_t count;     // repeats since the hold started
+    uint32_t press_ms;  // first edge of the press that caused the event
+    uint32_t ms;        // detection time
+} button_event_t;
+
+class Button {
+    public:
+        Button(uint8_t pin);
+
+        void begin();   // init the pin, on ESP32 also the interrupt and the timer
+        void handle();  // sample the pin if there is no timer
+        bool event( button_event_t &e );          // next queued event, false if none
+        void applied( const button_event_t &e );  // event changed the light: update latencies
+
+        bool pressed() const { return _pressed; }
+        uint32_t events() const { return _events; }
+        uint32_t dropped() const { return _dropped; }    // queue was full
+        uint32_t latency_ms() const { return _latency_ms; }          // last press to light
+        uint32_t max_latency_ms() const { return _max_latency_ms; }  // worst press to light
+        uint32_t max_wait_ms() const { return _max_wait_ms; }        // worst detection to light
+
+    private:
+        void edge( uint32_t now );              // raw level change
+        void tick( uint32_t now, bool level );  // debounce and gesture timeouts
+        void emit( uint8_t type, uint32_t now );
+
+        static void isr( void *arg );
+        static void timer( void *arg );
+
+        uint8_t _pin;
+        bool _timer;    // pin is sampled by the timer, not handle()
+        bool _level;    // last polled level
+        bool _pressed;  // debounced level
+        uint8_t _state;
+        uint16_t _count;
+        volatile uint32_t _edge_ms;   // last raw edge
+        volatile uint32_t _first_ms;  // first raw edge after a stable level
+        uint32_t _press_ms;
+        uint32_t _since_ms;  // last gesture state change or repeat
+        button_event_t _queue[BUTTON_QUEUE];
+        std::atomic<uint32_t> _head;  // written by the producer
+        std::atomic<uint32_t> _tail;  // written by the consumer
+        uint32_t _events;
+        uint32_t _dropped;
+        uint32_t _latency_ms;
+        uint32_t _max_latency_ms;
+        uint32_t _max_wait_ms;
+};
+
+#endif
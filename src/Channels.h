@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>  // board defines
+#include <Gamma.h>
+
+/*
+Output channel table: CHANNEL(id, name, pin, curve, group)
+  id     enum suffix: LED_<id>
+  name   used by web (/channel, /color), mqtt commands and influx fields
+  pin    gpio of the pwm output
+  curve  slider value to duty curve, see Gamma.h
+  group  channels of one fixture, addressed together by the mqtt group command
+Define CHANNELS_FILE (e.g. -DCHANNELS_FILE='"my_channels.h"') for an own table.
+ESP32 LEDC limits the table to its outputs minus one for the health led (see Pwm.h):
+15 on the ESP32 (8 high and 8 low speed), 5 on the C3. The S3 table drives the WS2812.
+*/
+
+// Curves per channel, see Gamma.h
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+    #define DEFAULT_CURVE CURVE_LINEAR
+#else
+    #define DEFAULT_CURVE CURVE_QUADRATIC
+#endif
+
+#ifndef CURVE_R
+#define CURVE_R DEFAULT_CURVE
+#endif
+#ifndef CURVE_G
+#define CURVE_G DEFAULT_CURVE
+#endif
+#ifndef CURVE_B
+#define CURVE_B DEFAULT_CURVE
+#endif
+#ifndef CURVE_W
+#define CURVE_W DEFAULT_CURVE
+#endif
+
+#if defined(CHANNELS_FILE)
+    #include CHANNELS_FILE
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+    // my ESP32-C3 Super Mini
+    #define CHANNELS(CHANNEL) \
+        CHANNEL(R, "red",   4, CURVE_R, 0) \
+        CHANNEL(G, "green", 5, CURVE_G, 0) \
+        CHANNEL(B, "blue",  6, CURVE_B, 0) \
+        CHANNEL(W, "white", 7, CURVE_W, 1)
+#elif defined(CONFIG_IDF_TARGET_ESP32S3)
+    // on board WS2812, white scales the color
+    #define CHANNELS(CHANNEL) \
+        CHANNEL(R, "red",   48, CURVE_R, 0) \
+        CHANNEL(G, "green", 48, CURVE_G, 0) \
+        CHANNEL(B, "blue",  48, CURVE_B, 0) \
+        CHANNEL(W, "white", 48, CURVE_W, 0)
+#elif defined(ESP32)
+    // my ESP32 Minikit
+    #define CHANNELS(CHANNEL) \
+        CHANNEL(R, "red",   22, CURVE_R, 0) \
+        CHANNEL(G, "green", 21, CURVE_G, 0) \
+        CHANNEL(B, "blue",  17, CURVE_B, 0) \
+        CHANNEL(W, "white", 16, CURVE_W, 1)
+#elif defined(ESP8266)
+    // Mini Board
+    #define CHANNELS(CHANNEL) \
+        CHANNEL(R, "red",    4, CURVE_R, 0) \
+        CHANNEL(G, "green",  2, CURVE_G, 0) \
+        CHANNEL(B, "blue",  12, CURVE_B, 0) \
+        CHANNEL(W, "white", 14, CURVE_W, 1)
+#else
+    #error "no channel table for this board, define CHANNELS_FILE"
+#endif
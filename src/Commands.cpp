@@ -0,0 +1,262 @@
+#include <Commands.h>
+
+#include <app.h>
+#include <Effects.h>
+
+typedef struct {
+    const char *p;
+    const char *end;
+} cursor_t;
+
+typedef struct {
+    app_frame_t frame;
+    int32_t ms;  // transition time, -1 for default
+} batch_t;
+
+typedef struct {
+    const char *name;
+    bool (*action)( cursor_t &args, batch_t &batch );
+} cmd_t;
+
+static command_stats_t stats = { 0, 0, 0, 0 };
+
+
+static void skip_space( cursor_t &c ) {
+    while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == ',' || *c.p == '\r' || *c.p == '\n')) c.p++;
+}
+
+static bool parse_uint( cursor_t &c, uint32_t &value ) {
+    skip_space(c);
+    const char *p = c.p;
+    uint32_t base = 10;
+    if (c.end - p > 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+        base = 16;
+        p += 2;
+    }
+    const char *start = p;
+    uint32_t v = 0;
+    while (p < c.end) {
+        char ch = *p;
+        uint32_t digit;
+        if (ch >= '0' && ch <= '9') digit = ch - '0';
+        else if (base == 16 && (ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') digit = (ch | 0x20) - 'a' + 10;
+        else break;
+        if (v > (UINT32_MAX - digit) / base) return false;  // overflow
+        v = v * base + digit;
+        p++;
+    }
+    if (p == start) return false;
+    c.p = p;
+    value = v;
+    return true;
+}
+
+// optional trailing transition time
+static void parse_ms( cursor_t &c, batch_t &batch ) {
+    uint32_t ms;
+    if (parse_uint(c, ms) && ms <= INT32_MAX) batch.ms = ms;
+}
+
+static bool stage_value( cursor_t &args, batch_t &batch, led_t led ) {
+    uint32_t value;
+    if (!parse_uint(args, value)) return false;
+    app_stage(batch.frame, led, value > 1000 ? 1000 : value);
+    parse_ms(args, batch);
+    return true;
+}
+
+// channel or command name: letters, digits, '_' and '-'
+static size_t parse_word( cursor_t &c, const char *&word ) {
+    skip_space(c);
+    word = c.p;
+    while (c.p < c.end) {
+        char ch = *c.p | 0x20;
+        if (!((ch >= 'a' && ch <= 'z') || (*c.p >= '0' && *c.p <= '9') || *c.p == '_' || *c.p == '-')) break;
+        c.p++;
+    }
+    return c.p - word;
+}
+
+static bool current_power( const batch_t &batch ) {
+    return batch.frame.power >= 0 ? batch.frame.power : get_power();
+}
+
+static const cmd_t cmds[] = {
+    { "color",  []( cursor_t &args, batch_t &batch ) {
+        uint32_t value[LED_COUNT];
+        for (int i = LED_START; i < LED_COUNT; i++) {
+            if (!parse_uint(args, value[i]) || value[i] > 1000) return false;
+        }
+        for (int i = LED_START; i < LED_COUNT; i++) {
+            app_stage(batch.frame, static_cast<led_t>(i), value[i]);
+        }
+        parse_ms(args, batch);
+        return true; } },
+    { "channel", []( cursor_t &args, batch_t &batch ) {
+        const char *name;
+        size_t len = parse_word(args, name);
+        int led = find_channel(name, len);
+        return led >= 0 && stage_value(args, batch, static_cast<led_t>(led)); } },
+    { "group",  []( cursor_t &args, batch_t &batch ) {
+        uint32_t group, value;
+        if (!parse_uint(args, group) || !parse_uint(args, value)) return false;
+        bool found = false;
+        for (int i = LED_START; i < LED_COUNT; i++) {
+            if (get_group(static_cast<led_t>(i)) == group) {
+                app_stage(batch.frame, static_cast<led_t>(i), value > 1000 ? 1000 : value);
+                found = true;
+            }
+        }
+        parse_ms(args, batch);
+        return found; } },
+    { "toggle", []( cursor_t &args, batch_t &batch ) {
+        app_stage_power(batch.frame, !current_power(batch));
+        parse_ms(args, batch);
+        return true; } },
+    { "on",     []( cursor_t &args, batch_t &batch ) {
+        app_stage_power(batch.frame, true);
+        parse_ms(args, batch);
+        return true; } },
+    { "off",    []( cursor_t &args, batch_t &batch ) {
+        app_stage_power(batch.frame, false);
+        parse_ms(args, batch);
+        return true; } },
+    { "effect", []( cursor_t &args, batch_t & ) {
+        const char *name;
+        size_t len = parse_word(args, name);
+        int effect = effects_find(name, len);
+        if (effect < 0) return false;
+        effect_params_t p;
+        effects_get(p);
+        p.effect = effect;
+        if (!p.brightness) p.brightness = 255;
+        uint32_t v;
+        if (parse_uint(args, v)) p.speed = v > 255 ? 255 : v;
+        if (parse_uint(args, v)) p.size = v > 255 ? 255 : v;
+        if (parse_uint(args, v)) p.brightness = v > 255 ? 255 : v;
+        effects_set(p);
+        return true; } },
+    { "effectcolor", []( cursor_t &args, batch_t & ) {
+        effect_params_t p;
+        effects_get(p);
+        uint8_t color[8] = { 0 };
+        uint32_t v;
+        int n = 0;
+        while (n < 8 && parse_uint(args, v) && v <= 255) color[n++] = v;
+        if (n < 3) return false;
+        memcpy(p.color, color, 4);
+        if (n > 4) memcpy(p.color2, color + 4, 4);
+        effects_set(p);
+        return true; } },
+    { "wave",   []( cursor_t &args, batch_t & ) {
+        const char *name;
+        size_t len = parse_word(args, name);
+        int led = find_channel(name, len);
+        if (led < 0) return false;
+        len = parse_word(args, name);
+        if (len == 3 && strncasecmp(name, "off", 3) == 0) {
+            return app_wave(static_cast<led_t>(led), WAVE_BREATHE, 0);
+        }
+        int shape = wave_find(name, len);
+        uint32_t period = 5000, min = 0, max = 1000;
+        if (shape < 0) return false;
+        parse_uint(args, period);
+        parse_uint(args, min);
+        parse_uint(args, max);
+        return period && app_wave(static_cast<led_t>(led), static_cast<wave_shape_t>(shape), period,
+            min > 1000 ? 1000 : min, max > 1000 ? 1000 : max); } },
+    { "pwm",    []( cursor_t &args, batch_t & ) {
+        const char *name;
+        size_t len = parse_word(args, name);
+        int led = find_channel(name, len);
+        uint32_t freq, bits = 0;
+        if (led < 0 || !parse_uint(args, freq)) return false;
+        parse_uint(args, bits);
+        return bits <= 255 && app_pwm(static_cast<led_t>(led), freq, bits); } },
+    { "load",   []( cursor_t &args, batch_t & ) {
+        const char *name;
+        size_t len = parse_word(args, name);
+        int led = find_channel(name, len);
+        uint32_t mw;
+        if (led < 0 || !parse_uint(args, mw)) return false;
+        app_load(static_cast<led_t>(led), mw);
+        return true; } },
+    { "budget", []( cursor_t &args, batch_t & ) {
+        uint32_t mw;
+        if (!parse_uint(args, mw)) return false;
+        app_budget(mw);
+        return true; } },
+    { "fade",   []( cursor_t &args, batch_t & ) {
+        uint32_t ms;
+        if (!parse_uint(args, ms)) return false;
+        const char *name;
+        size_t len = parse_word(args, name);
+        int curve = Fade::find(name, len);
+        if (len && curve < 0) return false;
+        app_fade(ms);
+        if (curve >= 0) app_curve(static_cast<Fade::curve_t>(curve));
+        return true; } }
+};
+
+// case insensitive compare of a command name with the word
+static const cmd_t *find( const char *start, size_t len ) {
+    if (!len) return NULL;
+
+    for (const cmd_t &cmd : cmds) {
+        const char *n = cmd.name;
+        size_t i = 0;
+        while (i < len && n[i] && (start[i] | 0x20) == n[i]) i++;
+        if (i == len && !n[i]) return &cmd;
+    }
+    return NULL;
+}
+
+size_t command_execute( const char *payload, size_t len ) {
+    batch_t batch;
+    app_begin(batch.frame);
+    batch.ms = -1;
+
+    size_t executed = 0;
+    cursor_t c = { payload, payload + len };
+    stats.payloads++;
+
+    while (c.p < c.end) {
+        // one command up to the next ';'
+        const char *stop = c.p;
+        while (stop < c.end && *stop != ';') stop++;
+        cursor_t cmd = { c.p, stop };
+        c.p = (stop < c.end) ? stop + 1 : stop;
+
+        skip_space(cmd);
+        if (cmd.p == cmd.end) continue;  // empty command
+
+        const char *word;
+        size_t word_len = parse_word(cmd, word);
+        const cmd_t *found = find(word, word_len);
+        int led;
+        if (!found && (led = find_channel(word, word_len)) >= 0) {
+            // channel name as command: <name> value [ms]
+            if (stage_value(cmd, batch, static_cast<led_t>(led))) executed++;
+            else stats.invalid++;
+        }
+        else if (!found) {
+            stats.unknown++;
+        }
+        else if (found->action(cmd, batch)) {
+            executed++;
+        }
+        else {
+            stats.invalid++;
+        }
+    }
+
+    if (batch.frame.mask || batch.frame.power >= 0) {
+        app_commit(batch.frame, batch.ms >= 0 ? (uint32_t)batch.ms : get_fade());
+    }
+    stats.commands += executed;
+    return executed;
+}
+
+const command_stats_t &get_command_stats() {
+    return stats;
+}
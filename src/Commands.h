@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Parse and execute text commands (e.g. mqtt payloads) in place, without heap
+Several commands can be separated by ';', they are applied as one frame
+(see app_commit()). Numbers are decimal or 0x hex, a trailing number is the
+transition time in ms (default see app_fade()). Commands:
+  color v0 v1 ... [ms]  one value 0..1000 per channel of the table (see Channels.h)
+  <name> value [ms]     channel by name, e.g. red 500
+  channel <index|name> value [ms]
+  group g value [ms]    all channels of a group
+  on|off|toggle [ms]
+  fade ms [curve]       default transition time and easing: inout (default), linear, in or out
+  pwm <index|name> freq [bits]  pwm frequency in Hz, resolution 0 or missing for the highest possible
+  load <index|name> mW  power of the channel at full duty (see Power.h)
+  budget mW             power limit of all channels, 0 for none
+  effect name [speed [size [brightness]]]  strip effect (see Effects.h), 0..255
+  effectcolor r g b [w [r2 g2 b2 w2]]     effect colors 0..255
+  wave <index|name> <shape|off> [period_ms [min [max]]]  sine, triangle, sawtooth or breathe (see Waveform.h)
+Example: "fade 2000; color 1000 500 0 200; on"
+*/
+
+typedef struct {
+    uint32_t payloads;  // parsed payloads
+    uint32_t commands;  // executed commands
+    uint32_t unknown;   // unknown command names
+    uint32_t invalid;   // known commands with bad arguments
+} command_stats_t;
+
+// return number of executed commands, payload does not need to be 0 terminated
+size_t command_execute( const char *payload, size_t len );
+
+const command_stats_t &get_command_stats();
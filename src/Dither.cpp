@@ -0,0 +1,92 @@
+#include <Dither.h>
+
+#include <Arduino.h>
+#include <atomic>
+
+#if defined(ESP32) && __has_include(<esp_timer.h>)
+    #include <esp_timer.h>
+    #define DITHER_TIMER
+#endif
+
+static std::atomic<uint32_t> target[DITHER_CHANNELS];  // fraction bits << 24 | duty << bits
+static uint32_t tick_us = 0;
+static uint32_t channel_ns = 0;
+
+#if defined(DITHER_TIMER)
+static uint8_t pins[DITHER_CHANNELS];
+static uint8_t count = 0;
+static uint32_t acc[DITHER_CHANNELS];      // only touched by tick()
+static uint32_t written[DITHER_CHANNELS];  // duty last written by tick()
+static std::atomic<bool> refresh(true);    // pins were (re)attached, write all
+static uint32_t busy_us = 0;  // sum of tick times since the last ns calculation
+static uint32_t ticks = 0;
+
+// callback runs in the esp_timer task, not in an isr, so ledcWrite() is fine
+static void tick( void * ) {
+    uint32_t start = micros();
+    bool all = refresh.exchange(false, std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t t = target[i].load(std::memory_order_relaxed);
+        uint32_t duty = dither_step(acc[i], t & 0xffffff, t >> 24);
+        if (duty != written[i] || all) {
+            written[i] = duty;
+            ledcWrite(pins[i], duty);
+        }
+    }
+    uint32_t us = micros() - start;
+    if (us > tick_us) tick_us = us;
+    busy_us += us;
+    if (++ticks == 1000) {
+        channel_ns = (uint64_t)busy_us * 1000000 / ((uint64_t)ticks * count);
+        busy_us = 0;
+        ticks = 0;
+    }
+}
+#endif
+
+bool dither_begin( const uint8_t *channel_pins, uint8_t channels, uint32_t tick_us ) {
+    #if defined(DITHER_TIMER)
+        static esp_timer_handle_t timer = NULL;
+        if (DITHER_BITS == 0 || !channels || channels > DITHER_CHANNELS) return false;
+        if (!tick_us || (tick_us << DITHER_BITS) > DITHER_PATTERN_US) return false;
+        if (timer) {  // called again after the pins were attached again
+            dither_refresh();
+            return true;
+        }
+
+        for (uint8_t i = 0; i < channels; i++) {
+            pins[i] = channel_pins[i];
+        }
+        count = channels;
+
+        esp_timer_create_args_t args = {};
+        args.callback = tick;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "dither";
+        if (esp_timer_create(&args, &timer) != ESP_OK) {
+            timer = NULL;
+            return false;
+        }
+        if (esp_timer_start_periodic(timer, tick_us) != ESP_OK) {
+            esp_timer_delete(timer);
+            timer = NULL;
+            return false;
+        }
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+void dither_refresh() {
+    #if defined(DITHER_TIMER)
+        refresh.store(true, std::memory_order_release);
+    #endif
+}
+
+void dither_set( uint8_t channel, uint32_t duty, uint8_t bits ) {
+    if (channel < DITHER_CHANNELS) target[channel].store((uint32_t)bits << 24 | duty, std::memory_order_relaxed);
+}
+
+uint32_t dither_tick_us() { return tick_us; }
+uint32_t dither_channel_ns() { return channel_ns; }
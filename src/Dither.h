@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Temporal (first order sigma-delta) dithering of pwm duties
+Targets have up to DITHER_BITS fraction bits below the pwm resolution. A periodic
+timer adds each target to an accumulator, writes the integer part and keeps
+the fraction for the next tick, so the average duty over 2^bits ticks
+is the target. This adds resolution at low brightness without lowering the
+pwm frequency. The dither pattern repeats at most every 2^DITHER_BITS ticks.
+At the dimmest duties one step is a large brightness change, so that must stay
+well above the flicker threshold: 2^bits ticks may take at most DITHER_PATTERN_US
+(16 ticks of 250 us: 250 Hz worst case). More bits need a faster tick.
+ESP32 only (esp_timer), elsewhere dither_begin() fails and callers write directly.
+*/
+
+#ifndef DITHER_BITS
+#define DITHER_BITS 4  // 0 disables dithering
+#endif
+
+#ifndef DITHER_TICK_US
+#define DITHER_TICK_US 250
+#endif
+
+#define DITHER_PATTERN_US 5000  // longest dither cycle: 200 Hz
+
+#define DITHER_CHANNELS 16  // max ledc channels of any ESP32
+
+static_assert(DITHER_BITS >= 0 && DITHER_BITS <= 6, "0 to 6 dither bits");
+static_assert((DITHER_TICK_US << DITHER_BITS) <= DITHER_PATTERN_US, "dither cycle flickers: fewer bits or faster tick");
+
+// one tick for one channel: returns the duty to write, acc keeps the fraction
+inline uint32_t dither_step( uint32_t &acc, uint32_t target, uint8_t bits ) {
+    uint32_t sum = acc + target;
+    acc = sum & ((1u << bits) - 1);
+    return sum >> bits;
+}
+
+// start the timer for pins attached to ledc, again after a reattach; false without timer or if tick_us flickers
+bool dither_begin( const uint8_t *pins, uint8_t count, uint32_t tick_us = DITHER_TICK_US );
+void dither_refresh();  // write all outputs with the next tick, e.g. after a reattach
+void dither_set( uint8_t channel, uint32_t target, uint8_t bits );  // duty << bits, from any task
+
+uint32_t dither_tick_us();     // max cpu time of one tick
+uint32_t dither_channel_ns();  // average cpu time per channel and tick
@@ -0,0 +1,207 @@
+#include <Effects.h>
+
+#include <Arduino.h>
+#include <app.h>
+#include <Lut.h>
+#include <Seqlock.h>
+#include <Strip.h>
+
+#if defined(ESP32) && __has_include(<freertos/FreeRTOS.h>)
+    #include <freertos/FreeRTOS.h>
+    #include <freertos/task.h>
+    #include <freertos/semphr.h>
+    #define EFFECTS_TASK
+#endif
+
+static const char *const names[EFFECT_COUNT] = { "off", "rainbow", "chase", "twinkle", "gradient" };
+
+static Strip *strip = NULL;
+static Seqlock<effect_params_t> params;
+static uint32_t period_us = 1000000 / EFFECTS_FPS;
+static volatile bool owned = false;  // strip shows effects, not the channel colors
+static uint32_t seed = 0x12345678;
+
+static uint32_t frames = 0;
+static uint32_t dropped = 0;
+static uint32_t frame_us = 0;
+static uint32_t load_pm = 0;
+static uint32_t busy_us = 0;      // render time in the current load window
+static uint32_t window_us = 0;    // start of the load window
+
+
+static inline uint32_t xorshift( uint32_t &s ) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+static inline void put( uint8_t *buf, uint16_t i, strip_order_t order, uint8_t brightness,
+        uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0 ) {
+    strip_pack(order, buf + i * strip_bytes(order),
+        scale8(r, brightness), scale8(g, brightness), scale8(b, brightness), scale8(w, brightness));
+}
+
+static inline uint8_t mix( uint8_t a, uint8_t b, uint8_t t ) {
+    return a + (((int)b - a) * t) / 255;
+}
+
+void effects_render( const effect_params_t &p, uint32_t t_ms, uint8_t *buf, uint16_t pixels,
+        strip_order_t order, uint32_t &rnd ) {
+    if (!pixels) return;
+    switch (p.effect) {
+        case EFFECT_RAINBOW: {
+            // 16 bit hue: speed 255 is about one cycle per second, size cycles along the strip
+            uint32_t base = (uint64_t)t_ms * p.speed * 256 / 1000;
+            uint32_t step = (uint32_t)(p.size ? p.size : 1) * 65536 / pixels;
+            for (uint16_t i = 0; i < pixels; i++) {
+                const uint8_t *rgb = hue_table.rgb[((base + i * step) >> 8) & 0xff];
+                put(buf, i, order, p.brightness, rgb[0], rgb[1], rgb[2]);
+            }
+            break;
+        }
+        case EFFECT_CHASE: {
+            // dot of size pixels, speed 255 is about 100 pixels per second
+            uint16_t pos = (uint64_t)t_ms * p.speed / 2560 % pixels;
+            uint16_t len = p.size ? p.size : 1;
+            for (uint16_t i = 0; i < pixels; i++) {
+                bool dot = (uint16_t)((i + pixels - pos) % pixels) < len;
+                const uint8_t *c = dot ? p.color : p.color2;
+                put(buf, i, order, p.brightness, c[0], c[1], c[2], c[3]);
+            }
+            break;
+        }
+        case EFFECT_TWINKLE: {
+            // fade what is there, light up random pixels: size is the chance per pixel and frame in 1/4096
+            size_t len = pixels * strip_bytes(order);
+            uint8_t decay = 255 - (p.speed >> 2);
+            for (size_t i = 0; i < len; i++) {
+                buf[i] = scale8(buf[i], decay);
+            }
+            for (uint16_t i = 0; i < pixels; i++) {
+                if ((xorshift(rnd) & 0xfff) < p.size) {
+                    put(buf, i, order, p.brightness, p.color[0], p.color[1], p.color[2], p.color[3]);
+                }
+            }
+            break;
+        }
+        case EFFECT_GRADIENT: {
+            // color to color2 along the strip, moving smoothly with the sine table
+            uint32_t base = (uint64_t)t_ms * p.speed * 256 / 4000;
+            for (uint16_t i = 0; i < pixels; i++) {
+                uint8_t t = sine8(((base >> 8) + (uint32_t)i * 256 / pixels) & 0xff);
+                put(buf, i, order, p.brightness, mix(p.color[0], p.color2[0], t), mix(p.color[1], p.color2[1], t),
+                    mix(p.color[2], p.color2[2], t), mix(p.color[3], p.color2[3], t));
+            }
+            break;
+        }
+        default:
+            memset(buf, 0, pixels * strip_bytes(order));
+    }
+}
+
+#ifdef EFFECTS_TASK
+static SemaphoreHandle_t strip_mutex() {
+    static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();  // created on first use
+    return mutex;
+}
+
+void effects_lock() { xSemaphoreTake(strip_mutex(), portMAX_DELAY); }
+void effects_unlock() { xSemaphoreGive(strip_mutex()); }
+#else
+void effects_lock() {}
+void effects_unlock() {}
+#endif
+
+static void frame() {
+    effect_params_t p;
+    params.read(p);
+    effects_lock();  // ownership only changes while nobody else draws
+    if (p.effect == EFFECT_OFF || p.effect >= EFFECT_COUNT) {
+        owned = false;
+        effects_unlock();
+        return;
+    }
+    owned = true;
+    if (!get_power()) p.brightness = 0;
+
+    uint32_t start = micros();
+    effects_render(p, millis(), strip->buffer(), strip->pixels(), strip->order(), seed);
+    if (strip->show()) frames++;
+    else dropped++;
+    uint32_t us = micros() - start;
+    effects_unlock();
+
+    if (us > frame_us) frame_us = us;
+    busy_us += us;
+    if (start - window_us >= 1000000) {
+        load_pm = (uint64_t)busy_us * 1000 / (start - window_us);
+        busy_us = 0;
+        window_us = start;
+    }
+}
+
+#ifdef EFFECTS_TASK
+// Fixed rate renderer, a frame that could not start in time counts as dropped
+static void task( void *arg ) {
+    TickType_t last = xTaskGetTickCount();
+    TickType_t period = pdMS_TO_TICKS(period_us / 1000);
+    if (!period) period = 1;
+    while (true) {
+        if (xTaskDelayUntil(&last, period) == pdFALSE) dropped++;
+        frame();
+    }
+}
+#endif
+
+bool effects_begin( Strip *s, uint16_t fps ) {
+    if (!s || !fps) return false;
+    strip = s;
+    period_us = 1000000 / fps;
+    window_us = micros();
+    #ifdef EFFECTS_TASK
+        // above loop() priority, so wifi, mqtt or influx stalls do not delay frames
+        xTaskCreate(task, "effects", 3072, NULL, 2, NULL);
+    #endif
+    return true;
+}
+
+void effects_handle() {
+    #ifndef EFFECTS_TASK
+        static uint32_t next_us = 0;
+        if (!strip) return;
+        uint32_t now = micros();
+        if ((int32_t)(now - next_us) < 0) return;
+        if (next_us && now - next_us >= period_us) dropped += (now - next_us) / period_us;
+        next_us = now + period_us;
+        frame();
+    #endif
+}
+
+void effects_set( const effect_params_t &p ) {
+    params.write(p);
+}
+
+void effects_get( effect_params_t &p ) {
+    params.read(p);
+}
+
+bool effects_active() {
+    return owned;
+}
+
+int effects_find( const char *name, size_t len ) {
+    for (int i = 0; i < EFFECT_COUNT; i++) {
+        if (strlen(names[i]) == len && strncasecmp(names[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+const char *effects_name( int effect ) {
+    return (effect >= 0 && effect < EFFECT_COUNT) ? names[effect] : "unknown";
+}
+
+uint32_t effects_frames() { return frames; }
+uint32_t effects_dropped() { return dropped; }
+uint32_t effects_frame_us() { return frame_us; }
+uint32_t effects_load_pm() { return load_pm; }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <StripEncode.h>
+
+/*
+Animated effects for addressable strips (see Strip.h)
+Effects render into the strip back buffer at a fixed frame rate. On ESP32
+a timed task renders, so a blocked loop() does not stall the animation,
+elsewhere effects_handle() must be called from the loop.
+Color math is 8 bit fixed point with sine and hue tables from Lut.h.
+Parameters can be changed from any task, the renderer picks them up
+with the next frame.
+*/
+
+#ifndef EFFECTS_FPS
+#define EFFECTS_FPS 50
+#endif
+
+typedef enum { EFFECT_OFF, EFFECT_RAINBOW, EFFECT_CHASE, EFFECT_TWINKLE, EFFECT_GRADIENT, EFFECT_COUNT } effect_t;
+
+typedef struct {
+    uint32_t effect;      // effect_t
+    uint8_t speed;        // 0 stands still, 255 fastest
+    uint8_t size;         // rainbow: cycles per strip, chase: dot length, twinkle: density, gradient: unused
+    uint8_t brightness;   // 0..255
+    uint8_t reserved;
+    uint8_t color[4];     // r, g, b, w
+    uint8_t color2[4];    // background or gradient end
+} effect_params_t;
+
+class Strip;
+
+bool effects_begin( Strip *strip, uint16_t fps = EFFECTS_FPS );  // false without strip
+void effects_handle();  // render if a frame is due (only without render task)
+
+void effects_set( const effect_params_t &params );
+void effects_get( effect_params_t &params );
+bool effects_active();  // an effect is running and owns the strip
+void effects_lock();    // hold while drawing to the strip outside the renderer, see effects_active()
+void effects_unlock();
+
+int effects_find( const char *name, size_t len );  // effect_t or -1
+const char *effects_name( int effect );
+
+// render one frame into a buffer in wire order, t_ms is the animation time
+void effects_render( const effect_params_t &params, uint32_t t_ms, uint8_t *buf, uint16_t pixels,
+    strip_order_t order, uint32_t &seed );
+
+uint32_t effects_frames();    // frames shown
+uint32_t effects_dropped();   // frames not shown in time (render late or strip busy)
+uint32_t effects_frame_us();  // max render and show time of one frame
+uint32_t effects_load_pm();   // cpu share of rendering in per mille
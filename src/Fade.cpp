@@ -0,0 +1,60 @@
+#include <Fade.h>
+
+#include <string.h>
+#include <strings.h>
+
+#define FADE_ONE 0x10000UL  // 1.0 in 16 bit fixed point
+
+static const char *const names[Fade::CURVE_COUNT] = { "inout", "linear", "in", "out" };
+
+int Fade::find( const char *name, size_t len ) {
+    for (int i = 0; i < CURVE_COUNT; i++) {
+        if (strlen(names[i]) == len && strncasecmp(names[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+const char *Fade::name( int curve ) {
+    return (curve >= 0 && curve < CURVE_COUNT) ? names[curve] : "unknown";
+}
+
+Fade::Fade() : _from(0), _to(0), _start(0), _duration_ms(0), _curve(LINEAR), _active(false) {
+}
+
+void Fade::start( uint32_t from, uint32_t to, uint32_t duration_ms, uint32_t now, curve_t curve ) {
+    _from = from;
+    _to = to;
+    _start = now;
+    _duration_ms = duration_ms;
+    _curve = curve;
+    _active = (from != to && duration_ms > 0);
+}
+
+uint32_t Fade::value( uint32_t now ) {
+    if (!_active) return _to;
+
+    uint32_t elapsed = now - _start;
+    if (elapsed >= _duration_ms) {
+        _active = false;
+        return _to;
+    }
+
+    // progress 0..1 in fixed point, then apply the easing curve
+    uint32_t p = (uint32_t)(((uint64_t)elapsed * FADE_ONE) / _duration_ms);
+    switch (_curve) {
+        case EASE_IN:
+            p = (p * (uint64_t)p) >> 16;
+            break;
+        case EASE_OUT:
+            p = FADE_ONE - (((FADE_ONE - p) * (uint64_t)(FADE_ONE - p)) >> 16);
+            break;
+        case EASE_IN_OUT:  // smoothstep: p^2 * (3 - 2p)
+            p = (((p * (uint64_t)p) >> 16) * (3 * FADE_ONE - 2 * p)) >> 16;
+            break;
+        default:
+            break;
+    }
+
+    int64_t delta = (int64_t)_to - (int64_t)_from;
+    return (uint32_t)((int64_t)_from + ((delta * (int64_t)p) >> 16));
+}
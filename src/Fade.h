@@ -0,0 +1,37 @@
+#ifndef Fade_h
+#define Fade_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Time based transition of one duty value from a start to a target
+Interpolation uses 16 bit fixed point, no floats and no allocations.
+The value only depends on the current time, so a late tick just catches up.
+*/
+class Fade {
+    public:
+        typedef enum { EASE_IN_OUT, LINEAR, EASE_IN, EASE_OUT, CURVE_COUNT } curve_t;  // first is the default
+
+        static int find( const char *name, size_t len );  // curve_t by name (inout, linear, in, out) or -1
+        static const char *name( int curve );
+
+        Fade();
+
+        // start a transition from current value to target within duration_ms
+        void start( uint32_t from, uint32_t to, uint32_t duration_ms, uint32_t now, curve_t curve = EASE_IN_OUT );
+
+        uint32_t value( uint32_t now );  // interpolated value at time now, ends transition when done
+        uint32_t target() const { return _to; }
+        bool active() const { return _active; }
+
+    private:
+        uint32_t _from;
+        uint32_t _to;
+        uint32_t _start;
+        uint32_t _duration_ms;
+        curve_t _curve;
+        bool _active;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef Gamma_h
+#define Gamma_h
+
+#include <stdint.h>
+
+/*
+Slider value (0..1000) to pwm duty (0..range) tables, built at compile time
+Needs C++14 constexpr. Tables are const and end up in flash.
+Optional fraction bits (shift) give the same curve with a finer duty for dithering.
+*/
+
+#define GAMMA_VALUE_MAX 1000
+
+typedef enum {
+    CURVE_LINEAR,     // duty ~ value
+    CURVE_QUADRATIC,  // duty ~ value^2, but value 1 gives duty 1 (as the old value2duty())
+    CURVE_CIE1931,    // perceived lightness L* = value/10
+    CURVE_GAMMA       // duty ~ value^(gamma/100)
+} gamma_curve_t;
+
+namespace gamma_cx {
+    constexpr uint32_t isqrt( uint32_t x ) {
+        uint32_t r = 0;
+        while ((r + 1) * (r + 1) <= x) r++;
+        return r;
+    }
+
+    // natural log for 0 < x <= 1: reduce to [0.5, 1] then atanh series
+    constexpr double log( double x ) {
+        int k = 0;
+        while (x < 0.5) {
+            x *= 2;
+            k++;
+        }
+        double z = (x - 1) / (x + 1);
+        double z2 = z * z;
+        double term = z;
+        double sum = 0;
+        for (int n = 1; n < 40; n += 2) {
+            sum += term / n;
+            term *= z2;
+        }
+        return 2 * sum - k * 0.69314718055994530942;
+    }
+
+    // exp for y <= 0: halve until small, Taylor series, then square back
+    constexpr double exp( double y ) {
+        int n = 0;
+        while (y < -0.5) {
+            y /= 2;
+            n++;
+        }
+        double sum = 1;
+        double term = 1;
+        for (int i = 1; i < 20; i++) {
+            term *= y / i;
+            sum += term;
+        }
+        while (n--) sum *= sum;
+        return sum;
+    }
+
+    constexpr uint32_t round( double x ) {
+        return (uint32_t)(x + 0.5);
+    }
+
+    // duty 0..range << shift, the curve only depends on range
+    constexpr uint32_t duty( gamma_curve_t curve, uint32_t range, uint32_t gamma100, uint32_t value, uint32_t shift = 0 ) {
+        uint32_t min_value = isqrt(range);  // quadratic: value 1 still gives some light
+        range <<= shift;
+        if (value == 0) return 0;
+        if (value >= GAMMA_VALUE_MAX) return range;
+        switch (curve) {
+            case CURVE_QUADRATIC: {
+                uint32_t d = (range * (value + min_value)) / (GAMMA_VALUE_MAX + min_value);
+                return (uint64_t)d * d / range;
+            }
+            case CURVE_CIE1931: {
+                double l = value / 10.0;
+                double y = (l <= 8) ? l / 903.3 : ((l + 16) / 116) * ((l + 16) / 116) * ((l + 16) / 116);
+                return round(y * range);
+            }
+            case CURVE_GAMMA:
+                return round(exp(log((double)value / GAMMA_VALUE_MAX) * gamma100 / 100.0) * range);
+            default:
+                return (range * value + GAMMA_VALUE_MAX / 2) / GAMMA_VALUE_MAX;
+        }
+    }
+}
+
+template <gamma_curve_t curve, uint32_t range, uint32_t gamma100 = 220, uint32_t shift = 0>
+struct GammaTable {
+    static_assert((range << shift) <= UINT16_MAX, "duty range must fit into 16 bits");
+
+    uint16_t duty[GAMMA_VALUE_MAX + 1];
+
+    constexpr GammaTable() : duty() {
+        for (uint32_t value = 0; value <= GAMMA_VALUE_MAX; value++) {
+            duty[value] = gamma_cx::duty(curve, range, gamma100, value, shift);
+        }
+    }
+
+    // from 0 to range and never getting darker with a higher slider value
+    constexpr bool valid() const {
+        if (duty[0] != 0 || duty[GAMMA_VALUE_MAX] != (range << shift)) return false;
+        for (uint32_t value = 1; value <= GAMMA_VALUE_MAX; value++) {
+            if (duty[value] < duty[value - 1]) return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include <Influx.h>
+
+#include <time.h>
+
+static const uint32_t min_backoff_ms = 1000;
+static const uint32_t max_backoff_ms = 64000;
+
+#if defined(ESP8266)
+    static const uint16_t http_timeout_ms = 300;  // sent from loop(), keep it short
+#else
+    static const uint16_t http_timeout_ms = 5000;
+#endif
+
+Influx::Influx(const char *server, uint16_t port, const char *db, const char *agent) :
+    _server(server), _port(port), _agent(agent), _head(0), _tail(0),
+    _status(0), _post_time(0), _dropped(0), _backoff_ms(0), _retry_ms(0) {
+    snprintf(_uri, sizeof(_uri), "/write?db=%s&precision=s", db);
+}
+
+#if defined(INFLUX_TASK)
+void Influx::task( void *arg ) {
+    Influx *influx = (Influx *)arg;
+    while (true) {
+        while (influx->send())
+            ;
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+#endif
+
+void Influx::begin() {
+    _http.setReuse(true);
+    _http.setUserAgent(_agent);
+    _http.setTimeout(http_timeout_ms);
+    #if defined(INFLUX_TASK)
+        xTaskCreate(task, "influx", 4096, this, 1, NULL);
+    #endif
+}
+
+void Influx::handle() {
+    #if !defined(INFLUX_TASK)
+        while (send())
+            ;
+    #endif
+}
+
+// Only called from one producer context (loop)
+bool Influx::add( const char *line ) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= INFLUX_LINES) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    char *slot = _lines[head % INFLUX_LINES];
+    time_t now = time(NULL);
+    int len;
+    if (now > 1582230020) {  // valid ntp time, else influx uses receive time
+        len = snprintf(slot, INFLUX_LINE_MAX, "%s %lu", line, (unsigned long)now);
+    }
+    else {
+        len = snprintf(slot, INFLUX_LINE_MAX, "%s", line);
+    }
+    if (len >= INFLUX_LINE_MAX) {  // truncated point would be rejected anyway
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Only called from one consumer context (sender task or loop)
+bool Influx::send() {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    if (tail == head || !WiFi.isConnected()) return false;
+
+    uint32_t now = millis();
+    if (_backoff_ms && now - _retry_ms < _backoff_ms) return false;
+
+    // collect as many points as fit into one post
+    size_t len = 0;
+    uint32_t end = tail;
+    while (end != head) {
+        const char *line = _lines[end % INFLUX_LINES];
+        size_t n = strlen(line);
+        if (len + n + 1 >= sizeof(_batch)) break;
+        memcpy(&_batch[len], line, n);
+        len += n;
+        _batch[len++] = '\n';
+        end++;
+    }
+    _batch[len] = '\0';
+
+    // keep-alive: begin() reuses the connection of _client if still open
+    _http.begin(_client, _server, _port, _uri);
+    _status = _http.POST((uint8_t *)_batch, len);
+    if (_status > 0 && _http.getSize() > 0) {
+        _http.getString();  // drain response to keep the connection usable
+    }
+    _http.end();
+
+    if (_status >= 200 && _status < 300) {
+        _tail.store(end, std::memory_order_release);
+        _post_time = time(NULL);
+        _backoff_ms = 0;
+        return true;
+    }
+
+    if (_status >= 400 && _status < 500) {
+        _tail.store(end, std::memory_order_release);  // rejected points will never succeed
+        _dropped.fetch_add(end - tail, std::memory_order_relaxed);
+        _backoff_ms = 0;
+        return true;
+    }
+
+    _retry_ms = now;
+    _backoff_ms = _backoff_ms ? min(2 * _backoff_ms, max_backoff_ms) : min_backoff_ms;
+    return false;
+}
@@ -0,0 +1,78 @@
+#ifndef Influx_h
+#define Influx_h
+
+#include <Arduino.h>
+#include <atomic>
+
+#if defined(ESP8266)
+    #include <ESP8266WiFi.h>
+    #include <ESP8266HTTPClient.h>
+#else
+    #include <WiFi.h>
+    #include <HTTPClient.h>
+#endif
+
+#if defined(ESP32) && __has_include(<freertos/FreeRTOS.h>)
+    #define INFLUX_TASK  // else handle() sends from the loop
+#endif
+
+#ifndef INFLUX_LINES
+#define INFLUX_LINES 32      // buffered points (offline backlog)
+#endif
+
+#ifndef INFLUX_LINE_MAX
+#define INFLUX_LINE_MAX 256  // max length of one line protocol point incl. timestamp (16 channel pwm report)
+#endif
+
+#ifndef INFLUX_BATCH_MAX
+#define INFLUX_BATCH_MAX 2048  // max body size of one post
+#endif
+
+/*
+Buffered InfluxDB writer
+add() stamps and queues a point and never blocks.
+Points are posted in batches over one keep-alive connection.
+On ESP32 a low priority task sends, elsewhere handle() sends from loop().
+Failed posts are retried with exponential backoff, new points are dropped
+(and counted) while the buffer is full.
+*/
+class Influx {
+    public:
+        Influx(const char *server, uint16_t port, const char *db, const char *agent);
+
+        void begin();   // start the sender
+        void handle();  // send if due (no op with sender task)
+
+        bool add( const char *line );  // queue a point, false if dropped
+
+        int status() const { return _status; }       // last http status
+        time_t last_post() const { return _post_time; }  // time of last successful post
+        uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+        uint32_t queued() const { return _head - _tail; }
+
+    private:
+        #if defined(INFLUX_TASK)
+            static void task( void *arg );  // sender task
+        #endif
+        bool send();  // post one batch if due, true if something was sent
+
+        const char *_server;
+        uint16_t _port;
+        char _uri[80];
+        const char *_agent;
+
+        char _lines[INFLUX_LINES][INFLUX_LINE_MAX];
+        std::atomic<uint32_t> _head;  // written by add()
+        std::atomic<uint32_t> _tail;  // written by send()
+        char _batch[INFLUX_BATCH_MAX];
+
+        WiFiClient _client;
+        HTTPClient _http;
+        volatile int _status;
+        volatile time_t _post_time;
+        std::atomic<uint32_t> _dropped;  // counted by add() and send()
+        uint32_t _backoff_ms;
+        uint32_t _retry_ms;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include <Log.h>
+
+Log::Log() : _head(0), _tail(0), _window(0), _dropped(0), _limited(0), _truncated(0) {
+    for (uint32_t i = 0; i < LOG_RECORDS; i++) {
+        _records[i].seq.store(i, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < LOG_PRIORITIES; i++) {
+        _limit[i] = 0;
+        _count[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Log::limit( uint16_t pri, uint16_t per_second ) {
+    if (pri < LOG_PRIORITIES) _limit[pri] = per_second;
+}
+
+// Fixed one second windows. A concurrent window change may let a few extra records pass
+bool Log::allowed( uint16_t pri ) {
+    if (pri >= LOG_PRIORITIES || !_limit[pri]) return true;
+
+    uint32_t second = millis() / 1000;
+    uint32_t window = _window.load(std::memory_order_relaxed);
+    if (window != second && _window.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        for (int i = 0; i < LOG_PRIORITIES; i++) {
+            _count[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    if (_count[pri].fetch_add(1, std::memory_order_relaxed) >= _limit[pri]) {
+        _limited.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// Reserve the record at the head position, NULL if the buffer is full
+Log::record *Log::claim( uint32_t &pos ) {
+    pos = _head.load(std::memory_order_relaxed);
+    while (true) {
+        record *r = &_records[pos % LOG_RECORDS];
+        int32_t diff = (int32_t)(r->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return r;
+        }
+        else if (diff < 0) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+        else {
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Make a cut off message visible as such
+void Log::truncated( record *r ) {
+    memcpy(r->text + sizeof(r->text) - 4, "...", 4);
+    _truncated.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Log::add( uint16_t pri, const char *message ) {
+    if (!allowed(pri)) return false;
+
+    uint32_t pos;
+    record *r = claim(pos);
+    if (!r) return false;
+
+    r->pri = pri;
+    strncpy(r->text, message, sizeof(r->text) - 1);
+    r->text[sizeof(r->text) - 1] = '\0';
+    if (strlen(message) >= sizeof(r->text)) truncated(r);
+    publish(r, pos);
+    return true;
+}
+
+bool Log::vprintf( uint16_t pri, const char *format, va_list args ) {
+    if (!allowed(pri)) return false;
+
+    uint32_t pos;
+    record *r = claim(pos);
+    if (!r) return false;
+
+    r->pri = pri;
+    if (vsnprintf(r->text, sizeof(r->text), format, args) >= (int)sizeof(r->text)) truncated(r);
+    publish(r, pos);
+    return true;
+}
+
+bool Log::printf( uint16_t pri, const char *format, ... ) {
+    va_list args;
+    va_start(args, format);
+    bool rc = vprintf(pri, format, args);
+    va_end(args);
+    return rc;
+}
+
+// Only called from one consumer context. Stops at a record still being written
+size_t Log::drain( sink_t sink, size_t max ) {
+    size_t count = 0;
+    uint32_t pos = _tail.load(std::memory_order_relaxed);
+    while (count < max) {
+        record *r = &_records[pos % LOG_RECORDS];
+        if (r->seq.load(std::memory_order_acquire) != pos + 1) break;
+
+        sink(r->pri, r->text);
+        r->seq.store(pos + LOG_RECORDS, std::memory_order_release);
+        _tail.store(++pos, std::memory_order_relaxed);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,75 @@
+#ifndef Log_h
+#define Log_h
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdarg.h>
+
+#ifndef LOG_RECORDS
+#define LOG_RECORDS 32     // buffered records, power of two
+#endif
+
+#ifndef LOG_RECORD_MAX
+#define LOG_RECORD_MAX 160  // max length of one message incl. 0, longer ones are cut and end with ...
+#endif
+
+#ifndef LOG_PRIORITIES
+#define LOG_PRIORITIES 8    // syslog priorities LOG_EMERG (0) .. LOG_DEBUG (7)
+#endif
+
+/*
+Asynchronous log buffer
+add() and printf() format directly into a free record and never block,
+they can be called from any task (multi producer, lock free).
+drain() hands the records in order to a sink (e.g. Serial and syslog)
+and is called from one low priority context only.
+Records are dropped (and counted) while the buffer is full or
+if a priority exceeds its rate limit (records per second).
+*/
+class Log {
+    public:
+        typedef void (*sink_t)( uint16_t pri, const char *message );
+
+        Log();
+
+        void limit( uint16_t pri, uint16_t per_second );  // 0: unlimited (default)
+
+        bool add( uint16_t pri, const char *message );           // false if dropped
+        bool printf( uint16_t pri, const char *format, ... ) __attribute__((format(printf, 3, 4)));
+        bool vprintf( uint16_t pri, const char *format, va_list args );
+
+        size_t drain( sink_t sink, size_t max = LOG_RECORDS );  // number of records drained
+
+        uint32_t dropped() const { return _dropped; }  // buffer was full
+        uint32_t limited() const { return _limited; }  // over rate limit
+        uint32_t truncated() const { return _truncated; }  // cut to LOG_RECORD_MAX
+        uint32_t queued() const { return _head - _tail; }
+
+    private:
+        static_assert((LOG_RECORDS & (LOG_RECORDS - 1)) == 0, "LOG_RECORDS must be a power of two");
+
+        struct record {
+            std::atomic<uint32_t> seq;  // == position: free, position + 1: written
+            uint16_t pri;
+            char text[LOG_RECORD_MAX];
+        };
+
+        bool allowed( uint16_t pri );
+        record *claim( uint32_t &pos );
+        void truncated( record *r );
+        void publish( record *r, uint32_t pos ) { r->seq.store(pos + 1, std::memory_order_release); }
+
+        record _records[LOG_RECORDS];
+        std::atomic<uint32_t> _head;  // next position to claim by producers
+        std::atomic<uint32_t> _tail;  // next position to drain, only written by drain()
+
+        uint16_t _limit[LOG_PRIORITIES];
+        std::atomic<uint32_t> _window;  // second of current rate limit window
+        std::atomic<uint16_t> _count[LOG_PRIORITIES];  // records in current window
+
+        std::atomic<uint32_t> _dropped;
+        std::atomic<uint32_t> _limited;
+        std::atomic<uint32_t> _truncated;
+};
+
+#endif
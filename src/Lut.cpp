@@ -0,0 +1,6 @@
+#include <Lut.h>
+
+// in flash, shared by effects and waveforms
+constexpr SineTable sine_table;
+constexpr HueTable hue_table;
+constexpr BreatheTable breathe_table;
@@ -0,0 +1,81 @@
+#ifndef Lut_h
+#define Lut_h
+
+#include <stdint.h>
+
+#include <Gamma.h>  // gamma_cx::exp
+
+/*
+Lookup tables for animations, built at compile time like the duty tables in Gamma.h
+Phases are 8 bit (256 steps per cycle), values are unsigned fixed point.
+*/
+
+namespace lut_cx {
+    // sine of x in [-pi, pi]: Taylor series
+    constexpr double sin( double x ) {
+        double term = x;
+        double sum = x;
+        for (int n = 1; n < 12; n++) {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+}
+
+// 0..65535, phase 0 is the minimum (like a breathing cycle): (1 - cos) / 2
+struct SineTable {
+    uint16_t value[256];
+
+    constexpr SineTable() : value() {
+        for (int i = 0; i < 256; i++) {
+            double x = 3.14159265358979323846 * (i - 64) / 128;  // -pi/2 .. 3pi/2
+            if (x > 3.14159265358979323846) x -= 2 * 3.14159265358979323846;
+            value[i] = (uint16_t)((lut_cx::sin(x) + 1) / 2 * 65535 + 0.5);
+        }
+    }
+};
+
+// 0..65535, exponential breathing e^sin, normalized, phase 0 is the minimum
+// Stays dim longer and peaks shorter than the sine, closer to how breathing looks
+struct BreatheTable {
+    uint16_t value[256];
+
+    constexpr BreatheTable() : value() {
+        for (int i = 0; i < 256; i++) {
+            double x = 3.14159265358979323846 * (i - 64) / 128;
+            if (x > 3.14159265358979323846) x -= 2 * 3.14159265358979323846;
+            double low = gamma_cx::exp(-2);  // e^(sin - 1) at sin = -1
+            value[i] = (uint16_t)((gamma_cx::exp(lut_cx::sin(x) - 1) - low) / (1 - low) * 65535 + 0.5);
+        }
+    }
+};
+
+// fully saturated colors around the color wheel, r+g+b is constant for even brightness
+struct HueTable {
+    uint8_t rgb[256][3];
+
+    constexpr HueTable() : rgb() {
+        for (int h = 0; h < 256; h++) {
+            int sector = h * 3 / 256;         // red->green, green->blue, blue->red
+            int pos = h * 3 % 256;            // 0..255 within the sector
+            int a = 255 - pos;
+            int b = pos;
+            rgb[h][sector] = a;
+            rgb[h][(sector + 1) % 3] = b;
+            rgb[h][(sector + 2) % 3] = 0;
+        }
+    }
+};
+
+extern const SineTable sine_table;
+extern const HueTable hue_table;
+extern const BreatheTable breathe_table;
+
+inline uint16_t sine16( uint8_t phase ) { return sine_table.value[phase]; }
+inline uint8_t sine8( uint8_t phase ) { return sine_table.value[phase] >> 8; }
+
+// a * b / 256 with scale 255 keeping a
+inline uint8_t scale8( uint8_t a, uint8_t b ) { return ((uint16_t)a * (b + 1)) >> 8; }
+
+#endif
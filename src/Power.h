@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Power budget and energy accounting of pwm channels
+Load model: a channel draws its full power (mW) at full duty and scales
+linearly with the duty (leds and resistive loads switched by a mosfet).
+If all channels together would draw more than the budget, every duty is
+scaled by the same 16.16 fixed point factor, so colors keep their mix.
+Energy is integrated in mW*ms from the duties actually written.
+*/
+
+#define POWER_ONE 0x10000  // scale factor 1.0
+
+#ifndef POWER_CHANNEL_MW
+#define POWER_CHANNEL_MW 0  // default full power per channel, 0 for unknown
+#endif
+
+#ifndef POWER_BUDGET_MW
+#define POWER_BUDGET_MW 0  // default total budget, 0 for no limit
+#endif
+
+// load of one channel at duty 0..max
+inline uint32_t power_mw( uint32_t mw, uint32_t duty, uint32_t max ) {
+    if (!max) return 0;
+    return (uint64_t)mw * duty / max;
+}
+
+// factor that brings the load within the budget, POWER_ONE if it fits or without budget
+inline uint32_t power_scale( uint32_t load_mw, uint32_t budget_mw ) {
+    if (!budget_mw || load_mw <= budget_mw) return POWER_ONE;
+    return ((uint64_t)budget_mw << 16) / load_mw;  // rounds down: never above budget
+}
+
+inline uint32_t power_apply( uint32_t duty, uint32_t scale ) {
+    return ((uint64_t)duty * scale) >> 16;
+}
+
+// add the energy of ms at duty 0..max, in mW*ms
+inline void power_integrate( uint64_t &mwms, uint32_t mw, uint32_t duty, uint32_t max, uint32_t ms ) {
+    if (max) mwms += (uint64_t)mw * duty * ms / max;
+}
+
+inline uint32_t power_mwh( uint64_t mwms ) {
+    return mwms / 3600000;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Pwm defaults shared by the channels (see app.cpp) and the health led (see Breathing.h)
+Channels can change frequency and resolution at runtime, see app_pwm().
+The resolution is limited by the ledc clock: freq << bits must not exceed it.
+*/
+
+#ifndef PWM_FREQ
+#define PWM_FREQ 25000
+#endif
+
+#ifndef PWMRANGE
+#define PWMRANGE 1023
+#endif
+
+#ifndef PWMBITS
+#define PWMBITS 10
+#endif
+
+#ifndef PWM_CLOCK
+#define PWM_CLOCK 80000000  // ledc timer clock (APB)
+#endif
+
+#ifndef PWM_STAGGER
+#define PWM_STAGGER 1  // spread the on phases of the channels, see Stagger.h
+#endif
+
+#define PWM_FREQ_MIN 10
+#define PWM_BITS_MAX 16  // duty math is done in 16 bits
+
+// ledc outputs: SOC_LEDC_CHANNEL_NUM per speed mode, the classic ESP32 has a high and a low speed mode.
+// The core numbers them across the modes (ESP32: 0..7 high, 8..15 low speed).
+#if defined(SOC_LEDC_CHANNEL_NUM)
+    #define PWM_MODE_CHANNELS SOC_LEDC_CHANNEL_NUM
+    #if defined(SOC_LEDC_SUPPORT_HS_MODE) && SOC_LEDC_SUPPORT_HS_MODE
+        #define PWM_LEDC_CHANNELS (2 * SOC_LEDC_CHANNEL_NUM)
+    #else
+        #define PWM_LEDC_CHANNELS SOC_LEDC_CHANNEL_NUM
+    #endif
+#endif
+#define PWM_HEALTH_CHANNELS 1  // the health led takes one ledc output (see Breathing.h)
+
+// highest resolution the clock allows at freq, 0 if not even 1 bit
+inline uint8_t pwm_bits( uint32_t freq ) {
+    uint8_t max = PWM_BITS_MAX;
+    #if defined(SOC_LEDC_TIMER_BIT_WIDTH)
+        if (max > SOC_LEDC_TIMER_BIT_WIDTH) max = SOC_LEDC_TIMER_BIT_WIDTH;
+    #endif
+    if (freq < PWM_FREQ_MIN) return 0;
+    uint8_t bits = 0;
+    while (bits < max && ((uint64_t)freq << (bits + 1)) <= PWM_CLOCK) bits++;
+    return bits;
+}
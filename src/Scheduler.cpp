@@ -0,0 +1,56 @@
+#include <Scheduler.h>
+#include <Trace.h>
+
+Scheduler::Scheduler() : _count(0), _next(0) {
+}
+
+bool Scheduler::add( const char *name, task_t task, uint32_t period_ms, uint8_t priority, uint32_t deadline_ms ) {
+    if (_count >= SCHEDULER_TASKS) return false;
+
+    // insert behind tasks of same or higher priority
+    size_t pos = _count;
+    while (pos > 0 && _tasks[pos - 1].priority > priority) {
+        _tasks[pos] = _tasks[pos - 1];
+        pos--;
+    }
+
+    uint32_t now = millis();
+    _tasks[pos] = { name, task, period_ms, priority, deadline_ms, now, 0, 0, 0 };
+    _count++;
+    _next = now;
+    return true;
+}
+
+bool Scheduler::run() {
+    uint32_t now = millis();
+    if ((int32_t)(now - _next) < 0) return false;  // cheap exit: nothing due yet
+
+    for (size_t i = 0; i < _count; i++) {
+        entry &t = _tasks[i];
+        int32_t late = now - t.due;
+        if (late < 0) continue;
+
+        if ((uint32_t)late > t.deadline_ms) t.missed++;
+
+        // next period, or skip periods already missed completely
+        t.due += t.period_ms;
+        if ((int32_t)(now - t.due) >= 0) t.due = now + t.period_ms;
+
+        uint32_t start = micros();
+        TRACE_BEGIN(t.name);
+        t.task();
+        TRACE_END(t.name);
+        uint32_t us = micros() - start;
+        if (us > t.max_us) t.max_us = us;
+        t.runs++;
+
+        // tasks are rescheduled only here, so update the earliest due time
+        _next = _tasks[0].due;
+        for (size_t j = 1; j < _count; j++) {
+            if ((int32_t)(_tasks[j].due - _next) < 0) _next = _tasks[j].due;
+        }
+        return true;
+    }
+
+    return false;
+}
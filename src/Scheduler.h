@@ -0,0 +1,53 @@
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <Arduino.h>
+
+#ifndef SCHEDULER_TASKS
+#define SCHEDULER_TASKS 12
+#endif
+
+/*
+Cooperative scheduler for loop() handlers
+Each task has a period, a priority (0 is most important) and a deadline:
+a task that starts later than deadline_ms after it was due counts as missed.
+run() executes at most one due task, the one with the highest priority,
+so a high priority task waits for at most one other task.
+*/
+class Scheduler {
+    public:
+        typedef void (*task_t)();
+
+        Scheduler();
+
+        // register a task, false if table is full
+        bool add( const char *name, task_t task, uint32_t period_ms, uint8_t priority, uint32_t deadline_ms );
+
+        bool run();  // run the most important due task, false if none was due
+
+        size_t count() const { return _count; }
+        const char *name( size_t i ) const { return _tasks[i].name; }
+        uint32_t period( size_t i ) const { return _tasks[i].period_ms; }
+        uint32_t runs( size_t i ) const { return _tasks[i].runs; }
+        uint32_t missed( size_t i ) const { return _tasks[i].missed; }
+        uint32_t max_us( size_t i ) const { return _tasks[i].max_us; }  // longest run time
+
+    private:
+        struct entry {
+            const char *name;
+            task_t task;
+            uint32_t period_ms;
+            uint8_t priority;
+            uint32_t deadline_ms;
+            uint32_t due;
+            uint32_t runs;
+            uint32_t missed;
+            uint32_t max_us;
+        };
+
+        entry _tasks[SCHEDULER_TASKS];  // sorted by priority
+        size_t _count;
+        uint32_t _next;  // earliest due time of all tasks
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef Seqlock_h
+#define Seqlock_h
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+#if defined(ESP32) && __has_include(<freertos/FreeRTOS.h>)
+    #include <freertos/FreeRTOS.h>
+    #define SEQLOCK_MUX
+#endif
+
+#ifndef SEQLOCK_RETRIES
+#define SEQLOCK_RETRIES 8  // lock free read attempts before a reader takes the lock
+#endif
+
+/*
+Sequence lock for small plain structs
+Readers never see a half written value: they copy and retry if a write
+was in progress. After SEQLOCK_RETRIES attempts they copy under the
+writer lock, so a reader never spins on a preempted writer.
+On ESP32 writes are a critical section (spinlock, interrupts off on the
+writing core): a higher priority task can not preempt a write, also not
+on single core chips like the C3. Writes must be short and must not
+happen from interrupts. Elsewhere writers spin on an atomic flag.
+Values are copied as 32 bit atomic words, free of data races.
+*/
+template <typename T>
+class Seqlock {
+    public:
+        static_assert(std::is_trivially_copyable<T>::value, "only plain structs");
+        static_assert(sizeof(T) % sizeof(uint32_t) == 0, "size must be a multiple of 32 bits");
+
+        Seqlock() : _seq(0) {
+            for (std::atomic<uint32_t> &w : _words) w.store(0, std::memory_order_relaxed);
+            #if defined(SEQLOCK_MUX)
+                portMUX_INITIALIZE(&_mux);
+            #else
+                _lock.clear();
+            #endif
+        }
+
+        void write( const T &value ) {
+            uint32_t words[WORDS];
+            memcpy(words, &value, sizeof(words));
+
+            lock();
+            uint32_t seq = _seq.load(std::memory_order_relaxed);
+            _seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (size_t i = 0; i < WORDS; i++) _words[i].store(words[i], std::memory_order_relaxed);
+
+            _seq.store(seq + 2, std::memory_order_release);
+            unlock();
+        }
+
+        void read( T &value ) const {
+            uint32_t words[WORDS];
+            for (int retry = 0; retry < SEQLOCK_RETRIES; retry++) {
+                uint32_t seq = _seq.load(std::memory_order_acquire);
+                if (seq & 1) continue;
+                for (size_t i = 0; i < WORDS; i++) words[i] = _words[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq == _seq.load(std::memory_order_relaxed)) {
+                    memcpy(&value, words, sizeof(words));
+                    return;
+                }
+            }
+            lock();  // writers keep us busy: copy while none can write
+            for (size_t i = 0; i < WORDS; i++) words[i] = _words[i].load(std::memory_order_relaxed);
+            unlock();
+            memcpy(&value, words, sizeof(words));
+        }
+
+        uint32_t version() const { return _seq.load(std::memory_order_acquire) >> 1; }  // number of writes
+
+    private:
+        static const size_t WORDS = sizeof(T) / sizeof(uint32_t);
+
+        #if defined(SEQLOCK_MUX)
+            void lock() const { portENTER_CRITICAL(&_mux); }
+            void unlock() const { portEXIT_CRITICAL(&_mux); }
+
+            mutable portMUX_TYPE _mux;
+        #else
+            void lock() const { while (_lock.test_and_set(std::memory_order_acquire)); }
+            void unlock() const { _lock.clear(std::memory_order_release); }
+
+            mutable std::atomic_flag _lock;
+        #endif
+
+        std::atomic<uint32_t> _seq;  // odd while a write is in progress
+        std::atomic<uint32_t> _words[WORDS];
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include <Stagger.h>
+
+#include <math.h>
+
+
+static inline uint32_t weight_of( const uint32_t *weight, uint8_t i ) {
+    return weight ? weight[i] : 1;
+}
+
+// highest combined weight of the placed pulses within [start, start + len)
+// it is at the window start or where a placed pulse starts inside the window
+static uint32_t peak_in( uint32_t start, uint32_t len, const uint8_t *placed, uint8_t count,
+        const uint32_t *duty, const uint32_t *hpoint, const uint32_t *weight ) {
+    uint32_t peak = 0;
+    for (uint8_t p = 0; p <= count; p++) {
+        uint32_t at = start;
+        if (p < count) {
+            at = hpoint[placed[p]];
+            if (at <= start || at >= start + len) continue;
+        }
+        uint32_t sum = 0;
+        for (uint8_t q = 0; q < count; q++) {
+            uint8_t j = placed[q];
+            if (hpoint[j] <= at && at < hpoint[j] + duty[j]) sum += weight_of(weight, j);
+        }
+        if (sum > peak) peak = sum;
+    }
+    return peak;
+}
+
+void stagger( const uint32_t *duty, const uint32_t *weight, uint8_t count, uint32_t period, uint32_t *hpoint ) {
+    if (count > STAGGER_MAX) count = STAGGER_MAX;
+
+    // longest pulses first
+    uint8_t order[STAGGER_MAX];
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t k = i;
+        while (k > 0 && duty[order[k - 1]] < duty[i]) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = i;
+        hpoint[i] = 0;
+    }
+
+    uint8_t placed[STAGGER_MAX];
+    uint8_t n = 0;
+    for (uint8_t o = 0; o < count; o++) {
+        uint8_t i = order[o];
+        uint32_t d = duty[i];
+        if (d == 0 || d >= period) {  // off or always on: no edges to move
+            if (d) placed[n++] = i;
+            continue;
+        }
+
+        // candidates: period start and end, right after or right before a placed pulse
+        uint32_t best = 0;
+        uint32_t best_peak = UINT32_MAX;
+        for (uint8_t c = 0; c < 2 * n + 2; c++) {
+            int64_t at;
+            if (c == 0) at = 0;
+            else if (c == 1) at = period - d;
+            else if (c & 1) at = (int64_t)hpoint[placed[(c - 2) / 2]] - d;
+            else at = (int64_t)hpoint[placed[(c - 2) / 2]] + duty[placed[(c - 2) / 2]];
+            if (at < 0 || at + d > period) continue;
+
+            uint32_t peak = peak_in(at, d, placed, n, duty, hpoint, weight);
+            if (peak < best_peak) {
+                best_peak = peak;
+                best = at;
+            }
+        }
+        hpoint[i] = best;
+        placed[n++] = i;
+    }
+}
+
+void stagger_current( const uint32_t *duty, const uint32_t *hpoint, const uint32_t *weight, uint8_t count,
+        uint32_t period, uint32_t &peak, double &rms ) {
+    peak = 0;
+    double sum2 = 0;
+    for (uint32_t t = 0; t < period; t++) {
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (hpoint[i] <= t && t < hpoint[i] + duty[i]) sum += weight_of(weight, i);
+        }
+        if (sum > peak) peak = sum;
+        sum2 += (double)sum * sum;
+    }
+    rms = period ? sqrt(sum2 / period) : 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Phase offsets (ledc hpoint) that spread the on phases of pwm channels over the period
+Channels of the same ledc timer count together, so without offsets all outputs switch
+on at counter 0 and the supply sees the sum of all channel currents at once.
+A pulse is high from hpoint to hpoint + duty and never wraps around the period end.
+Channels are placed longest first where they add the lowest current peak.
+Duties that fit into one period together do not overlap at all.
+*/
+
+#define STAGGER_MAX 16
+
+// hpoint per channel for duties 0..period, weight (e.g. current) per channel or NULL for equal
+void stagger( const uint32_t *duty, const uint32_t *weight, uint8_t count, uint32_t period, uint32_t *hpoint );
+
+// combined weight of all channels over one period: peak and root mean square
+void stagger_current( const uint32_t *duty, const uint32_t *hpoint, const uint32_t *weight, uint8_t count,
+    uint32_t period, uint32_t &peak, double &rms );
@@ -0,0 +1,183 @@
+#include <Strip.h>
+
+#ifdef STRIP_RMT
+    #include <driver/rmt_encoder.h>
+    #include <esp_heap_caps.h>
+
+    // bytes encoder for the pixels followed by a copy encoder for the reset low time
+    typedef struct {
+        rmt_encoder_t base;
+        rmt_encoder_t *bytes;
+        rmt_encoder_t *copy;
+        int state;  // 0 pixels, 1 reset
+        rmt_symbol_word_t reset;
+    } strip_encoder_t;
+
+    static size_t IRAM_ATTR strip_encoder_encode( rmt_encoder_t *encoder, rmt_channel_handle_t channel,
+            const void *data, size_t size, rmt_encode_state_t *ret_state ) {
+        strip_encoder_t *e = __containerof(encoder, strip_encoder_t, base);
+        rmt_encode_state_t session = RMT_ENCODING_RESET;
+        int state = RMT_ENCODING_RESET;
+        size_t symbols = 0;
+
+        if (e->state == 0) {
+            symbols += e->bytes->encode(e->bytes, channel, data, size, &session);
+            if (session & RMT_ENCODING_COMPLETE) e->state = 1;
+            if (session & RMT_ENCODING_MEM_FULL) {
+                *ret_state = (rmt_encode_state_t)(state | RMT_ENCODING_MEM_FULL);
+                return symbols;
+            }
+        }
+        symbols += e->copy->encode(e->copy, channel, &e->reset, sizeof(e->reset), &session);
+        if (session & RMT_ENCODING_COMPLETE) {
+            e->state = 0;
+            state |= RMT_ENCODING_COMPLETE;
+        }
+        if (session & RMT_ENCODING_MEM_FULL) state |= RMT_ENCODING_MEM_FULL;
+        *ret_state = (rmt_encode_state_t)state;
+        return symbols;
+    }
+
+    static esp_err_t strip_encoder_reset( rmt_encoder_t *encoder ) {
+        strip_encoder_t *e = __containerof(encoder, strip_encoder_t, base);
+        rmt_encoder_reset(e->bytes);
+        rmt_encoder_reset(e->copy);
+        e->state = 0;
+        return ESP_OK;
+    }
+
+    static esp_err_t strip_encoder_del( rmt_encoder_t *encoder ) {
+        strip_encoder_t *e = __containerof(encoder, strip_encoder_t, base);
+        rmt_del_encoder(e->bytes);
+        rmt_del_encoder(e->copy);
+        free(e);
+        return ESP_OK;
+    }
+
+    static rmt_encoder_handle_t strip_encoder_new( const strip_timing_t &timing ) {
+        strip_encoder_t *e = (strip_encoder_t *)calloc(1, sizeof(strip_encoder_t));
+        if (!e) return NULL;
+        e->base.encode = strip_encoder_encode;
+        e->base.reset = strip_encoder_reset;
+        e->base.del = strip_encoder_del;
+
+        uint32_t bit[2];
+        strip_bit_symbols(timing, STRIP_RESOLUTION_HZ, bit);
+        rmt_bytes_encoder_config_t bytes_config = {};
+        bytes_config.bit0.val = bit[0];
+        bytes_config.bit1.val = bit[1];
+        bytes_config.flags.msb_first = 1;
+        rmt_copy_encoder_config_t copy_config = {};
+
+        uint32_t half = (uint64_t)timing.reset_us * STRIP_RESOLUTION_HZ / 1000000 / 2;
+        e->reset.duration0 = half;
+        e->reset.level0 = 0;
+        e->reset.duration1 = half;
+        e->reset.level1 = 0;
+
+        if (rmt_new_bytes_encoder(&bytes_config, &e->bytes) != ESP_OK) {
+            free(e);
+            return NULL;
+        }
+        if (rmt_new_copy_encoder(&copy_config, &e->copy) != ESP_OK) {
+            rmt_del_encoder(e->bytes);
+            free(e);
+            return NULL;
+        }
+        return &e->base;
+    }
+#endif
+
+Strip::Strip( uint8_t pin, uint16_t pixels, strip_order_t order, const strip_timing_t &timing, bool dma ) :
+    _pin(pin), _pixels(pixels), _order(order), _timing(timing), _dma(dma),
+    _len(pixels * strip_bytes(order)), _front(NULL), _back(NULL), _sending(false),
+    _frames(0), _busy(0), _show_us(0), _start_us(0), _send_us(0) {
+}
+
+#ifdef STRIP_RMT
+// Transmission done interrupt
+bool IRAM_ATTR Strip::done( rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *event, void *arg ) {
+    Strip *strip = (Strip *)arg;
+    strip->_send_us = micros() - strip->_start_us;
+    strip->_sending = false;
+    return false;
+}
+#endif
+
+bool Strip::begin() {
+    #ifdef STRIP_RMT
+        // DMA needs internal memory
+        uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT | (_dma ? MALLOC_CAP_DMA : 0);
+        _front = (uint8_t *)heap_caps_calloc(1, _len, caps);
+        _back = (uint8_t *)heap_caps_calloc(1, _len, caps);
+    #else
+        _front = (uint8_t *)calloc(1, _len);
+        _back = (uint8_t *)calloc(1, _len);
+    #endif
+    if (!_front || !_back) return false;
+
+    #ifdef STRIP_RMT
+        rmt_tx_channel_config_t config = {};
+        config.gpio_num = (gpio_num_t)_pin;
+        config.clk_src = RMT_CLK_SRC_DEFAULT;
+        config.resolution_hz = STRIP_RESOLUTION_HZ;
+        config.mem_block_symbols = _dma ? 1024 : SOC_RMT_MEM_WORDS_PER_CHANNEL;
+        config.trans_queue_depth = 1;
+        config.flags.with_dma = _dma;
+        if (rmt_new_tx_channel(&config, &_channel) != ESP_OK) return false;
+
+        rmt_tx_event_callbacks_t callbacks = {};
+        callbacks.on_trans_done = done;
+        rmt_tx_register_event_callbacks(_channel, &callbacks, this);
+
+        _encoder = strip_encoder_new(_timing);
+        if (!_encoder || rmt_enable(_channel) != ESP_OK) return false;
+    #endif
+    return true;
+}
+
+void Strip::set( uint16_t i, uint8_t r, uint8_t g, uint8_t b, uint8_t w ) {
+    if (i < _pixels && _back) strip_pack(_order, _back + i * strip_bytes(_order), r, g, b, w);
+}
+
+void Strip::fill( uint8_t r, uint8_t g, uint8_t b, uint8_t w ) {
+    if (!_back) return;
+    size_t n = strip_bytes(_order);
+    strip_pack(_order, _back, r, g, b, w);
+    for (size_t pos = n; pos < _len; pos += n) {
+        memcpy(_back + pos, _back, n);
+    }
+}
+
+bool Strip::busy() {
+    return _sending;
+}
+
+bool Strip::show() {
+    if (!_front) return false;
+    if (_sending) {
+        _busy++;
+        return false;
+    }
+
+    uint32_t start = micros();
+    uint8_t *sent = _back;
+    _back = _front;
+    _front = sent;
+    memcpy(_back, _front, _len);  // keep drawing on top of the current frame
+
+    #ifdef STRIP_RMT
+        rmt_transmit_config_t config = {};
+        _sending = true;
+        _start_us = micros();
+        if (rmt_transmit(_channel, _encoder, _front, _len, &config) != ESP_OK) {
+            _sending = false;
+            return false;
+        }
+    #endif
+    _frames++;
+
+    uint32_t us = micros() - start;
+    if (us > _show_us) _show_us = us;
+    return true;
+}
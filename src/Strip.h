@@ -0,0 +1,70 @@
+#ifndef Strip_h
+#define Strip_h
+
+#include <Arduino.h>
+#include <StripEncode.h>
+
+#if defined(ESP32) && __has_include(<driver/rmt_tx.h>)
+    #include <driver/rmt_tx.h>
+    #define STRIP_RMT
+#endif
+
+#ifndef STRIP_RESOLUTION_HZ
+#define STRIP_RESOLUTION_HZ 10000000  // RMT tick of 100 ns
+#endif
+
+/*
+Addressable led strip (WS2812, SK6812) on an RMT channel
+set() and fill() draw into a back buffer, show() swaps it with the front
+buffer and starts sending it in the background (with DMA if available),
+so the cpu is free while the bits go out. Several strips on different
+pins send in parallel, each on its own RMT channel.
+If the previous frame is still being sent, show() returns false and
+the frame can be shown with the next call.
+RAM: 2 buffers of 3 (RGB) or 4 (RGBW) bytes per pixel.
+*/
+class Strip {
+    public:
+        Strip( uint8_t pin, uint16_t pixels, strip_order_t order = STRIP_GRB,
+            const strip_timing_t &timing = STRIP_WS2812, bool dma = false );
+
+        bool begin();  // allocate buffers and RMT channel, false on error
+
+        void set( uint16_t i, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0 );
+        void fill( uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0 );
+        uint8_t *buffer() { return _back; }  // back buffer in wire order for renderers
+        bool show();   // start sending the back buffer, false if still busy with the last frame
+        bool busy();
+
+        uint16_t pixels() const { return _pixels; }
+        strip_order_t order() const { return _order; }
+        size_t ram() const { return 2 * _len; }         // framebuffer bytes
+        uint32_t frames() const { return _frames; }    // frames started
+        uint32_t busy_count() const { return _busy; }  // show() calls while sending
+        uint32_t show_us() const { return _show_us; }  // max cpu time of show()
+        uint32_t send_us() const { return _send_us; }  // duration of last transmission
+
+    private:
+        uint8_t _pin;
+        uint16_t _pixels;
+        strip_order_t _order;
+        const strip_timing_t &_timing;
+        bool _dma;
+        size_t _len;        // bytes per buffer
+        uint8_t *_front;    // sent by RMT
+        uint8_t *_back;     // drawn by set()
+        volatile bool _sending;
+        uint32_t _frames;
+        uint32_t _busy;
+        uint32_t _show_us;
+        volatile uint32_t _start_us;
+        volatile uint32_t _send_us;
+
+        #ifdef STRIP_RMT
+            static bool IRAM_ATTR done( rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *event, void *arg );
+            rmt_channel_handle_t _channel;
+            rmt_encoder_handle_t _encoder;
+        #endif
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include <StripEncode.h>
+
+const strip_timing_t STRIP_WS2812 = { 400, 850, 800, 450, 280 };
+const strip_timing_t STRIP_SK6812 = { 300, 900, 600, 600, 80 };
+
+size_t strip_pack( strip_order_t order, uint8_t *out, uint8_t r, uint8_t g, uint8_t b, uint8_t w ) {
+    switch (order) {
+        case STRIP_RGB:
+            out[0] = r; out[1] = g; out[2] = b;
+            return 3;
+        case STRIP_GRBW:
+            out[0] = g; out[1] = r; out[2] = b; out[3] = w;
+            return 4;
+        default:
+            out[0] = g; out[1] = r; out[2] = b;
+            return 3;
+    }
+}
+
+// round to ticks, at least one tick per phase, at most 15 bits
+static uint32_t ticks( uint32_t ns, uint32_t resolution_hz ) {
+    uint32_t t = ((uint64_t)ns * resolution_hz + 500000000) / 1000000000;
+    if (t < 1) t = 1;
+    if (t > 0x7fff) t = 0x7fff;
+    return t;
+}
+
+uint32_t strip_symbol( uint32_t high_ns, uint32_t low_ns, uint32_t resolution_hz ) {
+    return ticks(high_ns, resolution_hz) | (1u << 15) | (ticks(low_ns, resolution_hz) << 16);
+}
+
+void strip_bit_symbols( const strip_timing_t &timing, uint32_t resolution_hz, uint32_t bit[2] ) {
+    bit[0] = strip_symbol(timing.t0h_ns, timing.t0l_ns, resolution_hz);
+    bit[1] = strip_symbol(timing.t1h_ns, timing.t1l_ns, resolution_hz);
+}
+
+size_t strip_encode( const uint8_t *bytes, size_t len, const uint32_t bit[2], uint32_t *symbols, size_t maxsymbols ) {
+    size_t n = 0;
+    for (size_t i = 0; i < len && n + 8 <= maxsymbols; i++) {
+        uint8_t byte = bytes[i];
+        for (int b = 7; b >= 0; b--) {
+            symbols[n++] = bit[(byte >> b) & 1];
+        }
+    }
+    return n;
+}
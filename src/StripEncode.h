@@ -0,0 +1,39 @@
+#ifndef StripEncode_h
+#define StripEncode_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Portable part of the led strip driver (see Strip.h), also built for the native simulation
+Pixels are stored in wire order (e.g. GRB), so the RMT bytes encoder can send
+the framebuffer as is. Every bit becomes one RMT symbol: a high and a low phase.
+*/
+
+typedef enum { STRIP_GRB, STRIP_RGB, STRIP_GRBW } strip_order_t;
+
+typedef struct {
+    uint16_t t0h_ns, t0l_ns;  // 0 bit
+    uint16_t t1h_ns, t1l_ns;  // 1 bit
+    uint16_t reset_us;        // low time that ends a frame
+} strip_timing_t;
+
+extern const strip_timing_t STRIP_WS2812;
+extern const strip_timing_t STRIP_SK6812;
+
+// bytes per pixel in the framebuffer
+inline size_t strip_bytes( strip_order_t order ) { return order == STRIP_GRBW ? 4 : 3; }
+
+// store one pixel in wire order, returns bytes written
+size_t strip_pack( strip_order_t order, uint8_t *out, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0 );
+
+// RMT symbol word (as rmt_symbol_word_t): duration0:15 level0:1 duration1:15 level1:1
+uint32_t strip_symbol( uint32_t high_ns, uint32_t low_ns, uint32_t resolution_hz );
+
+// symbols for 0 and 1 bits at the given RMT resolution
+void strip_bit_symbols( const strip_timing_t &timing, uint32_t resolution_hz, uint32_t bit[2] );
+
+// reference encoder, msb first like the RMT bytes encoder: 8 symbols per byte, returns symbols written
+size_t strip_encode( const uint8_t *bytes, size_t len, const uint32_t bit[2], uint32_t *symbols, size_t maxsymbols );
+
+#endif
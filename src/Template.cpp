@@ -0,0 +1,70 @@
+#include <Template.h>
+
+Template::Template(const char *text, const var_t *vars, size_t count) :
+    _text(text), _vars(vars), _count(count) {
+}
+
+const Template::var_t *Template::find( const char *name ) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (strcmp(_vars[i].name, name) == 0) return &_vars[i];
+    }
+    return NULL;
+}
+
+size_t Template::render( char *buf, size_t maxlen, size_t &pos ) const {
+    size_t len = 0;
+
+    while (len < maxlen) {
+        char c = pgm_read_byte(_text + pos);
+        if (!c) break;
+
+        if (c != '%') {
+            // copy static text up to the next placeholder or end of chunk
+            size_t n = 1;
+            while (len + n < maxlen) {
+                char next = pgm_read_byte(_text + pos + n);
+                if (!next || next == '%') break;
+                n++;
+            }
+            memcpy_P(buf + len, _text + pos, n);
+            len += n;
+            pos += n;
+            continue;
+        }
+
+        if (pgm_read_byte(_text + pos + 1) == '%') {
+            buf[len++] = '%';
+            pos += 2;
+            continue;
+        }
+
+        // placeholder: read name up to closing %
+        char name[TEMPLATE_NAME_MAX + 1];
+        size_t n = 0;
+        char nc;
+        while ((nc = pgm_read_byte(_text + pos + 1 + n)) && nc != '%' && n < TEMPLATE_NAME_MAX) {
+            name[n++] = nc;
+        }
+        name[n] = '\0';
+        const var_t *var = (nc == '%') ? find(name) : NULL;
+        if (!var) {
+            buf[len++] = '%';  // not a placeholder, keep as is
+            pos++;
+            continue;
+        }
+
+        // value must fit into the rest of this chunk, else try again in the next one
+        size_t room = maxlen - len;
+        int l = var->fill(buf + len, room);
+        if (l < 0) l = 0;
+        if ((size_t)l >= room) {
+            if (len > 0) break;
+            // does not even fit into an empty chunk: truncate, the NUL of the callback is not part of the chunk
+            l = strnlen(buf + len, room - 1);
+        }
+        len += l;
+        pos += n + 2;
+    }
+
+    return len;
+}
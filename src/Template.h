@@ -0,0 +1,38 @@
+#ifndef Template_h
+#define Template_h
+
+#include <Arduino.h>
+
+#ifndef TEMPLATE_NAME_MAX
+#define TEMPLATE_NAME_MAX 16  // longest placeholder name
+#endif
+
+/*
+Stream a text template with placeholders in chunks
+Placeholders look like %name% and "%%" is a literal '%' (like printf formats).
+The text can stay in flash (PROGMEM), no full page buffer is needed:
+render() fills one chunk at a time and remembers its position in &pos.
+Placeholder values are written directly into the chunk by callbacks.
+*/
+class Template {
+    public:
+        typedef struct {
+            const char *name;
+            // write value to buf, return length (like snprintf)
+            int (*fill)( char *buf, size_t maxlen );
+        } var_t;
+
+        Template(const char *text, const var_t *vars, size_t count);
+
+        // render next chunk into buf, start with pos = 0, returns 0 when done
+        size_t render( char *buf, size_t maxlen, size_t &pos ) const;
+
+    private:
+        const var_t *find( const char *name ) const;
+
+        const char *_text;
+        const var_t *_vars;
+        size_t _count;
+};
+
+#endif
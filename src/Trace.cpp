@@ -0,0 +1,131 @@
+#include <Trace.h>
+
+#ifdef TRACE
+
+#include <Arduino.h>
+#include <atomic>
+
+typedef struct {
+    std::atomic<uint32_t> seq;  // event number + 1 when complete, 0 while written
+    const char *name;
+    uint32_t ts_us;
+    int32_t arg;
+    char phase;
+    uint8_t tid;
+} trace_event_t;
+
+static trace_event_t events[TRACE_EVENTS];
+static std::atomic<uint32_t> next_event(0);
+
+#if defined(ESP32)
+// tid of the calling task: 1 + its index in the task table, 0 if the table is full
+static std::atomic<TaskHandle_t> tasks[TRACE_TASKS];
+
+static uint8_t task_id() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (uint8_t i = 0; i < TRACE_TASKS; i++) {
+        TaskHandle_t task = tasks[i].load(std::memory_order_acquire);
+        if (!task && tasks[i].compare_exchange_strong(task, self, std::memory_order_acq_rel)) return i + 1;
+        if (task == self) return i + 1;
+    }
+    return 0;
+}
+#endif
+
+void trace_record( const char *name, char phase, int32_t arg ) {
+    uint32_t n = next_event.fetch_add(1, std::memory_order_relaxed);
+    trace_event_t &e = events[n % TRACE_EVENTS];
+    e.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.name = name;
+    e.ts_us = micros();
+    e.arg = arg;
+    e.phase = phase;
+    #if defined(ESP32)
+        e.tid = task_id();
+    #else
+        e.tid = 0;
+    #endif
+    e.seq.store(n + 1, std::memory_order_release);
+}
+
+// append line of length l to buf if it fits, the line must be complete (not cut by its snprintf)
+static bool append( char *buf, size_t maxlen, size_t &len, const char *line, int l ) {
+    if (l < 0 || len + l >= maxlen) return false;
+    memcpy(buf + len, line, l);
+    len += l;
+    return true;
+}
+
+// pos 0: header, 1..TRACE_TASKS: task names, then events from oldest to newest, then footer
+size_t trace_json( char *buf, size_t maxlen, trace_cursor_t &c ) {
+    const size_t events_pos = 1 + TRACE_TASKS;
+    const size_t footer_pos = events_pos + TRACE_EVENTS;
+    size_t len = 0;
+    char line[128];
+
+    if (c.pos == 0) {
+        uint32_t last = next_event.load(std::memory_order_acquire);
+        c.first = last > TRACE_EVENTS ? last - TRACE_EVENTS : 0;
+        c.sep = false;
+        len = snprintf(buf, maxlen, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        if (len >= maxlen) return 0;
+        c.pos = 1;
+    }
+
+    while (c.pos < events_pos) {
+        #if defined(ESP32)
+            TaskHandle_t task = tasks[c.pos - 1].load(std::memory_order_acquire);
+            if (task) {
+                int l = snprintf(line, sizeof(line),
+                    "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    c.sep ? "," : "", (unsigned)c.pos, pcTaskGetName(task));
+                if (l < (int)sizeof(line)) {  // else skip it, a cut line would break the json
+                    if (!append(buf, maxlen, len, line, l)) return len;  // continue with this task next time
+                    c.sep = true;
+                }
+            }
+        #endif
+        c.pos++;
+    }
+
+    while (c.pos < footer_pos) {
+        uint32_t n = c.first + c.pos - events_pos;
+        trace_event_t &e = events[n % TRACE_EVENTS];
+        if (e.seq.load(std::memory_order_acquire) == n + 1) {
+            const char *name = e.name;
+            uint32_t ts_us = e.ts_us;
+            int32_t arg = e.arg;
+            char phase = e.phase;
+            uint8_t tid = e.tid;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.seq.load(std::memory_order_relaxed) == n + 1) {  // not overwritten while copied
+                int l;
+                if (phase == 'i') {
+                    l = snprintf(line, sizeof(line),
+                        "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%u,\"pid\":1,\"tid\":%u,\"args\":{\"v\":%d}}",
+                        c.sep ? "," : "", name, ts_us, tid, arg);
+                }
+                else {
+                    l = snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%u,\"pid\":1,\"tid\":%u}",
+                        c.sep ? "," : "", name, phase, ts_us, tid);
+                }
+                if (l < (int)sizeof(line)) {  // else skip it, e.g. a very long name
+                    if (!append(buf, maxlen, len, line, l)) return len;  // continue with this event next time
+                    c.sep = true;
+                }
+            }
+        }
+        c.pos++;  // skip events not yet written or already overwritten
+    }
+
+    if (c.pos == footer_pos) {
+        static const char footer[] = "]}";
+        if (!append(buf, maxlen, len, footer, sizeof(footer) - 1)) return len;
+        c.pos++;
+    }
+
+    return len;
+}
+
+#endif
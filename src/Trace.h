@@ -0,0 +1,46 @@
+#ifndef Trace_h
+#define Trace_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Event trace recorder, enabled with build flag -DTRACE
+Events go into a fixed size lock-free ring buffer, the oldest are overwritten.
+Names must be string literals (only the pointer is stored).
+Each FreeRTOS task gets its own tid, so spans of tasks sharing a core nest correctly.
+trace_json() renders the buffer in Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+Without TRACE all macros compile to nothing.
+*/
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 512
+#endif
+
+#ifndef TRACE_TASKS
+#define TRACE_TASKS 16  // tasks with their own trace line, others share tid 0
+#endif
+
+#ifdef TRACE
+    #define TRACE_BEGIN(name) trace_record(name, 'B', 0)
+    #define TRACE_END(name) trace_record(name, 'E', 0)
+    #define TRACE_INSTANT(name, arg) trace_record(name, 'i', arg)
+
+    void trace_record( const char *name, char phase, int32_t arg );
+
+    // Read position of one dump, each reader has its own
+    typedef struct {
+        size_t pos;      // 0: start
+        uint32_t first;  // oldest event of this dump
+        bool sep;        // an entry was written
+    } trace_cursor_t;
+
+    // Render events as JSON into buf, call with a zeroed cursor first and again until it returns 0
+    size_t trace_json( char *buf, size_t maxlen, trace_cursor_t &cursor );
+#else
+    #define TRACE_BEGIN(name) do {} while (0)
+    #define TRACE_END(name) do {} while (0)
+    #define TRACE_INSTANT(name, arg) do {} while (0)
+#endif
+
+#endif
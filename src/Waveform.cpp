@@ -0,0 +1,84 @@
+#include <Waveform.h>
+
+#include <string.h>
+#include <strings.h>
+
+#include <Lut.h>
+
+static const char *const names[WAVE_COUNT] = { "sine", "triangle", "sawtooth", "breathe", "custom" };
+
+
+Waveform::Waveform( wave_shape_t shape, uint32_t period_ms, uint32_t min, uint32_t max ) :
+    _shape(shape), _period_ms(period_ms ? period_ms : 1), _start(0), _min(min), _max(max), _table(NULL) {
+}
+
+void Waveform::shape( wave_shape_t shape, const uint16_t *table ) {
+    if (shape == WAVE_CUSTOM && !table) return;
+    _shape = shape;
+    _table = table;
+}
+
+void Waveform::period( uint32_t period_ms, uint32_t now ) {
+    if (!period_ms || period_ms == _period_ms) return;
+    // same phase with the new period
+    _start = now - (uint32_t)((uint64_t)phase(now) * period_ms >> 16);
+    _period_ms = period_ms;
+}
+
+void Waveform::limits( uint32_t min, uint32_t max ) {
+    _min = min;
+    _max = max;
+}
+
+void Waveform::start( uint32_t now ) {
+    _start = now;
+}
+
+uint16_t Waveform::phase( uint32_t now ) const {
+    uint32_t elapsed = (now - _start) % _period_ms;
+    return ((uint64_t)elapsed << 16) / _period_ms;
+}
+
+uint32_t Waveform::value( uint32_t now ) const {
+    uint32_t l = level(shape(), _table, phase(now));
+    if (_max >= _min) {
+        return _min + (uint32_t)(((uint64_t)(_max - _min) * (l + (l >> 15))) >> 16);  // 65535 -> max
+    }
+    return _min - (uint32_t)(((uint64_t)(_min - _max) * (l + (l >> 15))) >> 16);  // inverted limits
+}
+
+// linear interpolation between neighbouring entries of a 256 entry table
+static uint16_t interpolate( const uint16_t *table, uint16_t phase ) {
+    uint8_t i = phase >> 8;
+    int32_t a = table[i];
+    int32_t b = table[(uint8_t)(i + 1)];
+    return a + (((b - a) * (int32_t)(phase & 0xff)) >> 8);
+}
+
+uint16_t Waveform::level( wave_shape_t shape, const uint16_t *table, uint16_t phase ) {
+    switch (shape) {
+        case WAVE_SINE:
+            return interpolate(sine_table.value, phase);
+        case WAVE_TRIANGLE: {
+            uint32_t t = (phase < 0x8000) ? phase : 0xffff - phase;  // 0..0x7fff
+            return (t << 1) | (t >> 14);
+        }
+        case WAVE_SAWTOOTH:
+            return phase;
+        case WAVE_CUSTOM:
+            return table ? interpolate(table, phase) : 0;
+        default:
+            return interpolate(breathe_table.value, phase);
+    }
+}
+
+int wave_find( const char *name, size_t len ) {
+    for (int i = 0; i < WAVE_CUSTOM; i++) {
+        if (strlen(names[i]) == len && strncasecmp(names[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+const char *wave_name( int shape ) {
+    return (shape >= 0 && shape < WAVE_COUNT) ? names[shape] : "unknown";
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Periodic waveform from lookup tables (see Lut.h)
+The phase is computed from the start time in O(1), so a late or rare update
+lands exactly where the wave should be without catching up cycle by cycle.
+Levels are 16 bit, interpolated between the 256 table entries, and scaled
+to the limits. The object is plain data: it can be copied into a Seqlock
+and evaluated from a timer while the loop changes a copy.
+*/
+
+typedef enum { WAVE_SINE, WAVE_TRIANGLE, WAVE_SAWTOOTH, WAVE_BREATHE, WAVE_CUSTOM, WAVE_COUNT } wave_shape_t;
+
+class Waveform {
+    public:
+        Waveform( wave_shape_t shape = WAVE_BREATHE, uint32_t period_ms = 5000, uint32_t min = 0, uint32_t max = UINT16_MAX );
+
+        void shape( wave_shape_t shape, const uint16_t *table = NULL );  // custom table: 256 levels 0..65535
+        void period( uint32_t period_ms, uint32_t now );  // change the cycle time, keeps the phase
+        void limits( uint32_t min, uint32_t max );  // value range of a cycle
+        void start( uint32_t now );  // restart at phase 0 (the minimum)
+
+        wave_shape_t shape() const { return static_cast<wave_shape_t>(_shape); }
+        uint32_t period() const { return _period_ms; }
+        uint32_t min() const { return _min; }
+        uint32_t max() const { return _max; }
+
+        uint16_t phase( uint32_t now ) const;  // 0..65535 within the current cycle
+        uint32_t value( uint32_t now ) const;  // min..max
+
+        static uint16_t level( wave_shape_t shape, const uint16_t *table, uint16_t phase );  // 0..65535
+
+    private:
+        uint32_t _shape;
+        uint32_t _period_ms;
+        uint32_t _start;
+        uint32_t _min;
+        uint32_t _max;
+        const uint16_t *_table;
+};
+
+int wave_find( const char *name, size_t len );  // wave_shape_t or -1, custom has no name
+const char *wave_name( int shape );
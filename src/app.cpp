@@ -1,190 +1,1090 @@
 #include <Arduino.h>
 
 #include <app.h>
+#include <Fade.h>
+#include <Gamma.h>
+#include <Power.h>
+#include <Pwm.h>
+#include <Seqlock.h>
+#include <Trace.h>
 
-#if defined(CONFIG_IDF_TARGET_ESP32C3)
-  // my ESP32-C3 Super Mini
-  const uint8_t PINS[LED_COUNT] = { 4, 5, 6, 7 };
-#elif defined(CONFIG_IDF_TARGET_ESP32S3)
-    #include <esp32-hal-rgb-led.h>
-    const uint8_t pin = 48;  // WS2812 
-#elif defined(ESP32)
-  // my ESP32 Minikit 
-  const uint8_t PINS[LED_COUNT] = { 22, 21, 17, 16 };
-#elif defined(ESP8266)
-  // Mini Board
-  const uint8_t PINS[LED_COUNT] = { 4, 2, 12, 14 };
+typedef struct {
+    const char *id;
+    const char *name;
+    uint8_t pin;
+    gamma_curve_t curve;
+    uint8_t group;
+} channel_t;
+
+#define CHANNEL_ENTRY(id, name, pin, curve, group) { #id, name, pin, curve, group },
+static const channel_t channels[LED_COUNT] = { CHANNELS(CHANNEL_ENTRY) };
+#undef CHANNEL_ENTRY
+
+#if defined(ESP32) && !defined(CONFIG_IDF_TARGET_ESP32S3) && defined(PWM_LEDC_CHANNELS)
+    static_assert(LED_COUNT + PWM_HEALTH_CHANNELS <= PWM_LEDC_CHANNELS, "more channels than LEDC outputs left by the health led");
 #endif
 
-// Arduino 2 api: const uint8_t CHAN[LED_COUNT] = { 1, 2, 3, 4 };
+#if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(STRIP_PIN)
+    // S3: WS2812 on the pin of the first channel, all pixels show the color of the channels
+    // Others: optional strip on STRIP_PIN for effects only, see Effects.h
+    #include <Strip.h>
+    #include <Effects.h>
+
+    #ifndef STRIP_PIN
+    #define STRIP_PIN channels[LED_START].pin
+    #endif
+
+    #ifndef STRIP_PIXELS
+    #define STRIP_PIXELS 1  // on board led
+    #endif
+
+    #ifndef STRIP_DMA
+    #define STRIP_DMA false
+    #endif
 
-#define PWM_FREQ 25000
+    static Strip strip(STRIP_PIN, STRIP_PIXELS, STRIP_GRB, STRIP_WS2812, STRIP_DMA);
 
-#ifndef PWMRANGE
-#define PWMRANGE 1023
+    class StripLock {
+        public:
+            StripLock() { effects_lock(); }
+            ~StripLock() { effects_unlock(); }
+    };
 #endif
 
-#ifndef PWMBITS
-#define PWMBITS 10
+// Arduino 2 api: const uint8_t CHAN[LED_COUNT] = { 1, 2, 3, 4 };
+
+// Commits come from the loop (mqtt, button, transitions) and from the web server task (AsyncTCP).
+// Functions changing the state below hold this recursive lock, readers in other tasks use the snapshot.
+#if defined(ESP32) && __has_include(<freertos/semphr.h>)
+    #include <freertos/FreeRTOS.h>
+    #include <freertos/semphr.h>
+
+    static SemaphoreHandle_t app_mutex() {
+        static SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();  // created on first use
+        return mutex;
+    }
+
+    class AppLock {
+        public:
+            AppLock() { xSemaphoreTakeRecursive(app_mutex(), portMAX_DELAY); }
+            ~AppLock() { xSemaphoreGiveRecursive(app_mutex()); }
+    };
+#else
+    class AppLock {  // single task: nothing to serialize
+        public:
+            AppLock() {}
+    };
 #endif
 
 static bool isOn = true;
-static uint32_t duty[LED_COUNT] = { 0 };
+static uint32_t request[LED_COUNT] = { 0 };  // duty of the slider value
+static uint32_t duty[LED_COUNT] = { 0 };  // target duty if on, request within the power budget
+static uint32_t output[LED_COUNT] = { 0 };  // duty currently written to hardware
+static uint32_t output_dirty = 0;  // bit per led with output not yet written to hardware
+static Fade fade[LED_COUNT];
+static uint32_t fade_ms = FADE_MS;  // default transition time
+static Fade::curve_t fade_curve = Fade::EASE_IN_OUT;
+static uint32_t tick_us = 0;  // max cpu time of one transition tick
+static Seqlock<app_snapshot_t> snapshot;  // for readers in other tasks, see publish()
+
+// Waveforms instead of slider values, see app_wave()
+typedef struct {
+    uint32_t mask;  // bit per led with a waveform
+    Waveform wave[LED_COUNT];  // in slider values 0..1000
+} waves_t;
+
+static Seqlock<waves_t> waves;  // written by app_wave(), read by wave_tick()
+static uint32_t wave_mask = 0;  // copy of waves.mask for the loop
+static volatile uint32_t wave_output[LED_COUNT] = { 0 };  // duty last set by wave_tick()
+static int wave_max[LED_COUNT] = { 0 };  // highest slider value of each wave
+
+#if defined(ESP32) && !defined(CONFIG_IDF_TARGET_ESP32S3) && __has_include(<esp_timer.h>)
+    // ledc outputs of waves are written from a timer, independent of the loop
+    // S3 and others: waves are set in handle_app() and written with the other outputs
+    #include <esp_timer.h>
+    #define WAVE_TIMER
+#endif
+
+#ifndef WAVE_TICK_MS
+#define WAVE_TICK_MS 5
+#endif
+
+// Duties carry up to DITHER_BITS fraction bits where the dither timer writes the ledc outputs, see Dither.h
+#include <Dither.h>
+#if defined(WAVE_TIMER) && DITHER_BITS > 0
+    #define DUTY_SHIFT DITHER_BITS
+#else
+    #define DUTY_SHIFT 0
+#endif
+static bool dithering = false;  // dither timer is running
+
+// Pwm of each channel, see app_pwm(). Duties of a channel are 0..range << shift
+typedef struct {
+    uint32_t freq;   // Hz
+    uint8_t bits;    // requested resolution, 0 for the highest at freq
+    uint8_t res;     // resolution in use
+    uint8_t shift;   // dither fraction bits
+    uint8_t reserved;
+    uint32_t range;  // max integer duty
+} pwm_t;
+
+static pwm_t pwm[LED_COUNT];
+
+// Power budget, see Power.h
+static uint32_t load_mw[LED_COUNT] = { 0 };  // load model: power of each channel at full duty
+static uint32_t budget_mw = POWER_BUDGET_MW;  // 0 for no limit
+static uint32_t target_mw = 0;  // load of all requested duties
+static volatile uint32_t power_factor = POWER_ONE;  // scale of all duties to stay within the budget
+static uint64_t energy[LED_COUNT] = { 0 };  // mW*ms since boot
+
+#if PWM_STAGGER && defined(ESP32) && !defined(CONFIG_IDF_TARGET_ESP32S3) \
+        && __has_include(<driver/ledc.h>) && __has_include(<esp32-hal-periman.h>)
+    // on phases of the ledc outputs are spread over the period, see Stagger.h
+    #include <Stagger.h>
+    #include <driver/ledc.h>
+    #include <esp32-hal-periman.h>
+    #define STAGGER
+    static uint32_t hpoint[LED_COUNT] = { 0 };  // phase offset of each output
+#endif
 
 // ESP32 only thing?
 #include <Preferences.h>
 Preferences prefs;
-static uint32_t duty_dirty[LED_COUNT] = { 0 };  // time of last duty change or 0 if no change since last save
-uint32_t status_dirty = 0;  // time of last isOn change or 0 if no change since last save
 static int duty_value[LED_COUNT] = { 0 };
-static char slider[] = "sliderX";
+static uint32_t fade_active = 0;  // bit per led with an active transition
 
+// Persistent state: one versioned and crc checked record, saved after a quiet period
+// New fields go to the end and bump STATE_VERSION. Shorter records of older versions
+// are read as far as they go, missing fields keep their defaults.
+#define STATE_KEY "state"
+#define STATE_VERSION 4
 
-static uint32_t value2duty( int value ) {
-    #if defined(CONFIG_IDF_TARGET_ESP32S3)
-        return map(value, 0, 1000, 0, 255);  // RGB
+#ifndef STATE_QUIET_MS
+#define STATE_QUIET_MS 1000  // save if there was no change for this long
+#endif
+
+// Flash wear estimate: NVS writes entries of 32 bytes round robin into pages of 126 entries
+#define NVS_ENTRY 32
+#define NVS_PAGE_ENTRIES 126
+#ifndef NVS_PAGES
+#define NVS_PAGES 5  // nvs partition 0x6000 is 6 pages, one is kept free
+#endif
+#define FLASH_ERASE_CYCLES 100000
+
+// Per channel settings
+typedef struct {
+    int16_t value;      // slider value 0..1000
+    uint8_t bits;       // pwm resolution, 0 for the highest the clock allows at freq
+    uint8_t reserved;
+    uint32_t freq;      // pwm frequency in Hz
+    uint32_t load_mw;   // power at full duty, 0 for unknown
+} channel_state_t;
+
+// Channels are last, so a changed channel count only changes the record size
+typedef struct {
+    uint32_t crc;       // crc32 of the record after this field
+    uint16_t version;
+    uint16_t size;      // record bytes including header
+    uint32_t writes;    // number of saves, for wear accounting
+    uint8_t on;
+    uint8_t curve;      // easing of transitions, Fade::curve_t (0 in records from before it was saved)
+    uint8_t reserved[2];
+    uint32_t fade_ms;   // default transition time
+    uint32_t budget_mw; // power limit of all channels, 0 for none
+    channel_state_t channel[LED_COUNT];
+} state_t;
+
+// Version 3 record: no power settings
+typedef struct {
+    int16_t value;
+    uint8_t bits;
+    uint8_t reserved;
+    uint32_t freq;
+} channel_v3_t;
+
+typedef struct {
+    uint32_t crc;
+    uint16_t version;
+    uint16_t size;
+    uint32_t writes;
+    uint8_t on;
+    uint8_t reserved[3];
+    uint32_t fade_ms;
+    channel_v3_t channel[1];
+} state_v3_t;
+
+// Version 2 record: slider values only, as many as the record size says
+typedef struct {
+    uint32_t crc;
+    uint16_t version;
+    uint16_t size;
+    uint32_t writes;
+    uint8_t on;
+    uint8_t reserved[3];
+    uint32_t fade_ms;
+    int16_t value[1];
+} state_v2_t;
+
+// Version 1 record of fixed RGBW firmware
+typedef struct {
+    uint32_t crc;
+    uint16_t version;
+    uint16_t size;
+    uint32_t writes;
+    int16_t value[4];
+    uint8_t on;
+    uint8_t reserved[3];
+    uint32_t fade_ms;
+} state_v1_t;
+
+static state_t state = { 0, STATE_VERSION, sizeof(state_t), 0, true, Fade::EASE_IN_OUT, { 0 }, FADE_MS, POWER_BUDGET_MW, { } };
+static uint32_t state_dirty = 0;  // time of last change or 0 if no change since last save
+static bool state_migrate = false;  // remove old single value keys after next save
+
+
+// Duty tables per curve (see Gamma.h), shared by all channels with the same curve
+// Pwm tables have the curve of the default range with 16 bits, scaled to the range of each channel
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+    #define CURVE_RANGE UINT8_MAX  // RGB
+    #define CURVE_SHIFT 0
+#else
+    #define CURVE_RANGE PWMRANGE
+    #define CURVE_SHIFT (PWM_BITS_MAX - PWMBITS)
+#endif
+#define TABLE_MAX (CURVE_RANGE << CURVE_SHIFT)
+
+#ifndef GAMMA  // exponent * 100 for CURVE_GAMMA
+#define GAMMA 220
+#endif
+
+static constexpr GammaTable<CURVE_LINEAR, CURVE_RANGE, GAMMA, CURVE_SHIFT> table_linear;
+static constexpr GammaTable<CURVE_QUADRATIC, CURVE_RANGE, GAMMA, CURVE_SHIFT> table_quadratic;
+static constexpr GammaTable<CURVE_CIE1931, CURVE_RANGE, GAMMA, CURVE_SHIFT> table_cie1931;
+static constexpr GammaTable<CURVE_GAMMA, CURVE_RANGE, GAMMA, CURVE_SHIFT> table_gamma;
+
+static_assert(table_linear.valid() && table_quadratic.valid() && table_cie1931.valid() && table_gamma.valid(),
+    "duty tables must rise monotonic from 0 to full range");
+
+static const uint16_t *const curve_table[] = { table_linear.duty, table_quadratic.duty, table_cie1931.duty, table_gamma.duty };
+
+// convert slider value (0..1000) to duty (0..range << shift of the channel), fits 32 bit math
+static inline uint32_t value2duty( led_t led, int value ) {
+    uint32_t max = pwm[led].range << pwm[led].shift;
+    return (curve_table[channels[led].curve][value] * max + TABLE_MAX / 2) / TABLE_MAX;
+}
+
+// resolution and dither bits for a frequency, false if the clock does not allow it
+static bool pwm_config( led_t led, uint32_t freq, uint8_t bits ) {
+    #if defined(ESP32) && !defined(CONFIG_IDF_TARGET_ESP32S3)
+        uint8_t max = pwm_bits(freq);
+        uint8_t res = bits ? bits : max;
+        if( !res || res > max ) return false;
+        uint8_t shift = (DUTY_SHIFT > PWM_BITS_MAX - res) ? PWM_BITS_MAX - res : DUTY_SHIFT;
+        pwm[led] = { freq, bits, res, shift, 0, (1u << res) - 1 };
+    #elif defined(CONFIG_IDF_TARGET_ESP32S3)
+        pwm[led] = { 0, 8, 8, 0, 0, UINT8_MAX };  // strip colors
     #else
-        // 0=0, 1=1, then duty ~ value^2 with duty=PWMRANGE for value=1000
-        const int min_value = sqrt(PWMRANGE);
-        if (value > 0) value += min_value;
-        uint32_t new_duty = (PWMRANGE * value) / (1000 + min_value);
-        new_duty *= new_duty;   // smaller duty has smaller steps...
-        new_duty /= PWMRANGE;   // ...by quadratic function
-        return new_duty;
+        pwm[led] = { PWM_FREQ, PWMBITS, PWMBITS, 0, 0, PWMRANGE };  // analogWrite() is global
     #endif
+    return true;
 }
 
+// set new output duty, written to hardware by write_outputs()
 static void set_duty( led_t led, uint32_t new_duty ) {
+    if( new_duty != output[led] ) {
+        output[led] = new_duty;
+        output_dirty |= 1 << led;
+    }
+}
+
+// highest duty of a channel
+static inline uint32_t full_duty( led_t led ) {
+    return pwm[led].range << pwm[led].shift;
+}
+
+// scale all requested duties (waves at their highest value) into the power budget
+// returns bit per led whose limited duty changed, only the staged ones while the factor stays
+static uint32_t limit_duties( uint32_t staged ) {
+    uint32_t load = 0;
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        if( !load_mw[i] ) continue;
+        led_t led = static_cast<led_t>(i);
+        uint32_t d = (wave_mask & (1 << i)) ? value2duty(led, wave_max[i]) : request[i];
+        load += power_mw(load_mw[i], d, full_duty(led));
+    }
+    target_mw = load;
+
+    uint32_t factor = power_scale(load, budget_mw);
+    uint32_t update = (factor != power_factor) ? (1u << LED_COUNT) - 1 : staged;
+    power_factor = factor;
+
+    uint32_t changed = 0;
+    for( ; update; update &= update - 1 ) {
+        led_t led = static_cast<led_t>(__builtin_ctz(update));
+        uint32_t d = power_apply(request[led], factor);
+        if( d != duty[led] ) {
+            duty[led] = d;
+            changed |= 1 << led;
+        }
+    }
+    return changed;
+}
+
+// add the energy of the duties written since the last call
+static void integrate_energy() {
+    static uint32_t last = millis();
+    uint32_t now = millis();
+    uint32_t ms = now - last;
+    last = now;
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        if( !load_mw[i] ) continue;
+        uint32_t full = full_duty(static_cast<led_t>(i));
+        uint32_t d = (wave_mask & (1 << i)) ? wave_output[i] : output[i];
+        power_integrate(energy[i], load_mw[i], d > full ? 0 : d, full, ms);
+    }
+}
+
+#if defined(ESP32) && !defined(CONFIG_IDF_TARGET_ESP32S3)
+// hand a duty to the dither timer, or write its integer part directly
+static void write_pin( led_t led, uint32_t d ) {
+    if( dithering ) {
+        dither_set(led, d, pwm[led].shift);
+    }
+    else {
+        ledcWrite(channels[led].pin, d >> pwm[led].shift);
+    }
+}
+#endif
+
+// push changed outputs to hardware, the WS2812 gets one frame for all channels
+// while the strip still sends the last frame, the outputs stay dirty for the next tick
+static void write_outputs() {
     #if defined(CONFIG_IDF_TARGET_ESP32S3)
-        if (isOn) {
-            int r = map(duty[LED_R], 0, UINT8_MAX, 0, duty[LED_W]);
-            int g = map(duty[LED_G], 0, UINT8_MAX, 0, duty[LED_W]);
-            int b = map(duty[LED_B], 0, UINT8_MAX, 0, duty[LED_W]);
-            rgbLedWrite(pin, r, g, b);
+        StripLock lock;  // the effects task renders into the same strip buffer
+        static bool effects = false;
+        if( effects_active() ) {  // strip shows an effect
+            effects = true;
+            return;
         }
-        else {
-            rgbLedWrite(pin, 0, 0, 0);
+        if( effects ) {  // effect ended, show the channel colors again
+            effects = false;
+            output_dirty = (1 << LED_COUNT) - 1;
         }
-    #elif defined(ESP32)
-        ledcWrite(PINS[led], new_duty);
+    #endif
+    #if defined(WAVE_TIMER)
+        output_dirty &= ~wave_mask;  // written by wave_tick()
+    #endif
+    if( !output_dirty ) return;
+    TRACE_INSTANT("write_outputs", output_dirty);
+    #if defined(CONFIG_IDF_TARGET_ESP32S3)
+        int r = map(output[LED_R], 0, UINT8_MAX, 0, output[LED_W]);
+        int g = map(output[LED_G], 0, UINT8_MAX, 0, output[LED_W]);
+        int b = map(output[LED_B], 0, UINT8_MAX, 0, output[LED_W]);
+        strip.fill(r, g, b);
+        if( !strip.show() ) return;
     #else
-        analogWrite(PINS[led], new_duty);
+        for( uint32_t dirty = output_dirty; dirty; dirty &= dirty - 1 ) {
+            int i = __builtin_ctz(dirty);
+            #if defined(ESP32)
+                write_pin(static_cast<led_t>(i), output[i]);
+            #else
+                analogWrite(channels[i].pin, output[i]);
+            #endif
+        }
+    #endif
+    output_dirty = 0;
+}
+
+#if defined(STAGGER)
+// move the on phase of a ledc output, ledcWrite() keeps it
+static void write_hpoint( led_t led, uint32_t h ) {
+    ledc_channel_handle_t *bus = (ledc_channel_handle_t *)perimanGetPinBus(channels[led].pin, ESP32_BUS_TYPE_LEDC);
+    if( !bus ) return;
+    ledc_mode_t group = (ledc_mode_t)(bus->channel / PWM_MODE_CHANNELS);  // same split as the core
+    ledc_channel_t channel = (ledc_channel_t)(bus->channel % PWM_MODE_CHANNELS);
+    ledc_set_duty_with_hpoint(group, channel, ledc_get_duty(group, channel), h);
+    ledc_update_duty(group, channel);
+}
+#endif
+
+// spread the on phases of channels with the same pwm timing over the period
+// pulses are sized for the longest duty until the next update: fade start or target,
+// highest wave value and the dither rounding up, so they never reach past the period
+static void update_hpoints() {
+    #if defined(STAGGER)
+        uint32_t done = 0;
+        for( int i = LED_START; i < LED_COUNT; i++ ) {
+            if( done & (1 << i) ) continue;
+            uint32_t d[LED_COUNT], h[LED_COUNT];
+            uint8_t index[LED_COUNT];
+            uint8_t n = 0;
+            for( int j = i; j < LED_COUNT; j++ ) {
+                if( pwm[j].freq != pwm[i].freq || pwm[j].res != pwm[i].res ) continue;
+                led_t led = static_cast<led_t>(j);
+                uint32_t target = isOn ? duty[j] : 0;
+                uint32_t longest = (wave_mask & (1 << j)) ? value2duty(led, wave_max[j])
+                    : (output[j] > target ? output[j] : target);
+                d[n] = (longest + (1u << pwm[j].shift) - 1) >> pwm[j].shift;
+                index[n++] = j;
+                done |= 1 << j;
+            }
+            stagger(d, NULL, n, pwm[i].range + 1, h);
+            for( uint8_t k = 0; k < n; k++ ) {
+                if( h[k] != hpoint[index[k]] ) {
+                    hpoint[index[k]] = h[k];
+                    write_hpoint(static_cast<led_t>(index[k]), h[k]);
+                }
+            }
+        }
     #endif
 }
 
+static uint32_t crc32( const void *data, size_t len ) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t crc = 0xffffffff;
+    while( len-- ) {
+        crc ^= *(p++);
+        for( int bit = 0; bit < 8; bit++ ) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+// start to accumulate rapid changes to save flash
+static void state_changed() {
+    state_dirty = millis();
+    if( !state_dirty ) state_dirty--;  // Make sure update time is never set to 0
+}
+
+// read state record or migrate from single value keys of older firmware
+static void load_state() {
+    uint8_t buf[sizeof(state_t) + 128] = { 0 };  // room for records of newer versions or more channels
+    state_t *stored = (state_t *)buf;
+    size_t len = prefs.getBytesLength(STATE_KEY);
+
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        state.channel[i] = { 250, 0, 0, PWM_FREQ, POWER_CHANNEL_MW };  // channels not in the record
+    }
+
+    if( len >= offsetof(state_v2_t, value) && len <= sizeof(buf)
+            && prefs.getBytes(STATE_KEY, buf, len) == len
+            && stored->size == len
+            && stored->crc == crc32(&stored->version, len - sizeof(stored->crc)) ) {
+        if( stored->version == 1 && len >= sizeof(state_v1_t) ) {
+            const state_v1_t *v1 = (const state_v1_t *)buf;
+            state.writes = v1->writes;
+            state.on = v1->on;
+            state.fade_ms = v1->fade_ms;
+            for( int i = LED_START; i < LED_COUNT && i < 4; i++ ) {
+                state.channel[i].value = v1->value[i];
+            }
+            state_changed();  // rewrite as current version
+        }
+        else if( stored->version == 2 ) {
+            const state_v2_t *v2 = (const state_v2_t *)buf;
+            state.writes = v2->writes;
+            state.on = v2->on;
+            state.fade_ms = v2->fade_ms;
+            size_t values = (len - offsetof(state_v2_t, value)) / sizeof(v2->value[0]);
+            for( int i = LED_START; i < LED_COUNT && i < (int)values; i++ ) {
+                state.channel[i].value = v2->value[i];
+            }
+            state_changed();
+        }
+        else if( stored->version == 3 && len >= offsetof(state_v3_t, channel) ) {
+            const state_v3_t *v3 = (const state_v3_t *)buf;
+            state.writes = v3->writes;
+            state.on = v3->on;
+            state.fade_ms = v3->fade_ms;
+            size_t count = (len - offsetof(state_v3_t, channel)) / sizeof(v3->channel[0]);
+            for( int i = LED_START; i < LED_COUNT && i < (int)count; i++ ) {
+                state.channel[i].value = v3->channel[i].value;
+                state.channel[i].bits = v3->channel[i].bits;
+                state.channel[i].freq = v3->channel[i].freq;
+            }
+            state_changed();
+        }
+        else if( stored->version >= STATE_VERSION && len >= offsetof(state_t, channel) ) {
+            memcpy(&state, buf, min(len, sizeof(state)));  // fields and channels of newer records are dropped
+        }
+        // else unknown version or too short for its version: keep the defaults
+        state.version = STATE_VERSION;
+        state.size = sizeof(state);
+        return;
+    }
+
+    state.on = prefs.getBool("on", true);
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        state.channel[i].value = prefs.getInt(get_slider(i), 250);
+    }
+    state_migrate = true;
+    state_changed();
+}
+
+// save state record if it differs from the last saved one
+static void save_state() {
+    state_t s = state;
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        s.channel[i].value = duty_value[i];
+        s.channel[i].bits = pwm[i].bits;
+        s.channel[i].freq = pwm[i].freq;
+        s.channel[i].load_mw = load_mw[i];
+    }
+    s.on = isOn;
+    s.fade_ms = fade_ms;
+    s.curve = fade_curve;
+    s.budget_mw = budget_mw;
+
+    if( !state_migrate && s.on == state.on && s.fade_ms == state.fade_ms && s.curve == state.curve
+            && s.budget_mw == state.budget_mw
+            && memcmp(&s.channel, &state.channel, sizeof(s.channel)) == 0 ) {
+        return;  // changed back to what is saved already
+    }
+
+    s.writes++;
+    s.crc = crc32(&s.version, sizeof(s) - sizeof(s.crc));
+    if( prefs.putBytes(STATE_KEY, &s, sizeof(s)) == sizeof(s) ) {
+        state = s;
+        if( state_migrate ) {
+            prefs.remove("on");
+            for( int i = LED_START; i < LED_COUNT; i++ ) {
+                prefs.remove(get_slider(i));
+            }
+            state_migrate = false;
+        }
+    }
+}
+
+// start transition of led output to its target duty (0 if off)
+static void fade_to( led_t led, uint32_t ms ) {
+    uint32_t target = isOn ? duty[led] : 0;
+    fade[led].start(output[led], target, ms, millis(), fade_curve);
+    if( fade[led].active() ) {
+        fade_active |= 1 << led;
+    }
+    else {
+        fade_active &= ~(1 << led);
+        set_duty(led, target);
+    }
+}
+
+// advance all active transitions, called from handle_app()
+static void fade_tick() {
+    uint32_t start = micros();
+    uint32_t now = millis();
+    bool busy = fade_active;
+    bool ended = false;
+    for( uint32_t active = fade_active; active; active &= active - 1 ) {
+        led_t led = static_cast<led_t>(__builtin_ctz(active));
+        set_duty(led, fade[led].value(now));
+        if( !fade[led].active() ) {
+            fade_active &= ~(1 << led);
+            ended = true;
+        }
+    }
+    write_outputs();
+    if( ended ) update_hpoints();  // pulses shrink to the target
+    if( busy ) {
+        uint32_t us = micros() - start;
+        if( us > tick_us ) tick_us = us;
+    }
+}
+
+// set the outputs of all waveforms from their phase now, off is 0
+// called from the wave timer, or from handle_app() without timer
+static void wave_tick() {
+    waves_t w;
+    waves.read(w);
+    if( !w.mask ) return;
+
+    app_snapshot_t s;
+    snapshot.read(s);
+    uint32_t now = millis();
+    for( uint32_t mask = w.mask; mask; mask &= mask - 1 ) {
+        led_t led = static_cast<led_t>(__builtin_ctz(mask));
+        uint32_t d = s.on ? power_apply(value2duty(led, w.wave[led].value(now)), power_factor) : 0;
+        #if defined(WAVE_TIMER)
+            if( d != wave_output[led] ) {
+                wave_output[led] = d;
+                write_pin(led, d);
+            }
+        #else
+            wave_output[led] = d;
+            set_duty(led, d);
+        #endif
+    }
+}
+
+#if defined(WAVE_TIMER)
+static void wave_timer( void * ) {
+    wave_tick();
+}
+#endif
 
-void app_value( led_t led, int value ) {
+
+// the load or budget changed: fade all channels to their new limited duties
+static void relimit( uint32_t ms ) {
+    uint32_t changed = limit_duties(0) & ~wave_mask;
+    if( !isOn ) return;
+    for( ; changed; changed &= changed - 1 ) {
+        fade_to(static_cast<led_t>(__builtin_ctz(changed)), ms);
+    }
+}
+
+// make committed changes visible to readers as a whole
+static void publish() {
+    app_snapshot_t s;
+    s.on = isOn;
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        s.value[i] = duty_value[i];
+        s.duty[i] = duty[i] >> pwm[i].shift;  // integer pwm duty
+    }
+    snapshot.write(s);
+}
+
+
+void app_begin( app_frame_t &frame ) {
+    frame.mask = 0;
+    frame.power = -1;
+}
+
+void app_stage( app_frame_t &frame, led_t led, int value ) {
     if( value < 0 || value > 1000 ) return;  // for now slider should send promille (0..1000)
-    uint32_t new_duty = value2duty(value);   // convert slider value to duty (0..PWMRANGE)
-    if( new_duty != duty[led] ) {
-        duty_dirty[led] = millis();  // start to accumulate rapid changes to save flash.
-        if( !duty_dirty[led] ) duty_dirty[led]--;  // Make sure update time is never set to 0
-        duty[led] = new_duty;
-        duty_value[led] = value; // for making persistent later
+    frame.value[led] = value;
+    frame.mask |= 1 << led;
+}
+
+void app_stage_power( app_frame_t &frame, bool on ) {
+    frame.power = on ? 1 : 0;
+}
+
+void app_commit( const app_frame_t &frame, uint32_t ms ) {
+    AppLock lock;
+    TRACE_INSTANT("app_commit", frame.mask);
+    uint32_t staged = 0;  // only touch staged channels, unless the power limit changes
+    for( uint32_t mask = frame.mask; mask; mask &= mask - 1 ) {
+        led_t led = static_cast<led_t>(__builtin_ctz(mask));
+        uint32_t new_duty = value2duty(led, frame.value[led]);  // convert slider value to duty of the channel range
+        if( new_duty != request[led] ) {
+            request[led] = new_duty;
+            staged |= 1 << led;
+        }
+        if( frame.value[led] != duty_value[led] ) {
+            duty_value[led] = frame.value[led]; // for making persistent later
+            state_changed();
+        }
+    }
+
+    uint32_t changed = limit_duties(staged);
+
+    bool toggle = frame.power >= 0 && (frame.power != 0) != isOn;
+    if( toggle ) {
+        isOn = !isOn;
+        state_changed();
+    }
+
+    uint32_t fades = toggle ? (1u << LED_COUNT) - 1 : (isOn ? changed : 0);
+    fades &= ~wave_mask;  // waves follow power by themselves
+    for( ; fades; fades &= fades - 1 ) {
+        fade_to(static_cast<led_t>(__builtin_ctz(fades)), ms);
+    }
+    if( changed || toggle ) update_hpoints();
+    write_outputs();
+    publish();
+}
+
+void app_value( led_t led, int value, uint32_t ms ) {
+    app_frame_t frame;
+    app_begin(frame);
+    app_stage(frame, led, value);
+    app_commit(frame, ms);
+}
+
+// brightness ramps keep the ratios of the channels, no mix (all 0) is white
+void app_level( const app_snapshot_t &mix, int level, uint32_t ms ) {
+    int top = 0;
+    for( int led = 0; led < LED_COUNT; led++ ) {
+        if( mix.value[led] > top ) top = mix.value[led];
+    }
+    app_frame_t frame;
+    app_begin(frame);
+    for( int led = 0; led < LED_COUNT; led++ ) {
+        app_stage(frame, static_cast<led_t>(led), top ? (mix.value[led] * level + top / 2) / top : level);
+    }
+    app_stage_power(frame, true);
+    app_commit(frame, ms);
+}
+
+void app_fade( uint32_t ms ) {
+    AppLock lock;
+    if( ms != fade_ms ) {
+        fade_ms = ms;
+        state_changed();
+    }
+}
+
+bool app_wave( led_t led, wave_shape_t shape, uint32_t period_ms, int min, int max, const uint16_t *table ) {
+    AppLock lock;
+    if( led < LED_START || led >= LED_COUNT || min < 0 || min > 1000 || max < 0 || max > 1000 ) return false;
+    if( period_ms && (shape >= WAVE_COUNT || (shape == WAVE_CUSTOM && !table)) ) return false;
+
+    uint32_t bit = 1 << led;
+    waves_t w;
+    waves.read(w);
+    if( !period_ms ) {  // stop and fade from the wave to the slider value
+        if( !(w.mask & bit) ) return true;
+        w.mask &= ~bit;
+        waves.write(w);
+        wave_mask = w.mask;
+        output[led] = wave_output[led];
+        relimit(fade_ms);
+        fade_to(led, fade_ms);
+        update_hpoints();
+        write_outputs();
+        publish();
+        return true;
+    }
+
+    uint32_t now = millis();
+    if( w.mask & bit ) {  // keep the phase of the running wave
+        w.wave[led].period(period_ms, now);
+    }
+    else {
+        w.wave[led] = Waveform(shape, period_ms);
+        w.wave[led].start(now);
     }
-    if( isOn ) {
-        set_duty(led, duty[led]);
+    w.wave[led].shape(shape, table);
+    w.wave[led].limits(min, max);
+    w.mask |= bit;
+    fade_active &= ~bit;
+    wave_max[led] = min > max ? min : max;
+    waves.write(w);
+    wave_mask = w.mask;
+    relimit(fade_ms);
+    update_hpoints();
+    write_outputs();
+    publish();
+    return true;
+}
+
+uint32_t get_waves() {
+    return wave_mask;
+}
+
+bool app_pwm( led_t led, uint32_t freq, uint8_t bits ) {
+    AppLock lock;
+    #if defined(ESP32) && !defined(CONFIG_IDF_TARGET_ESP32S3)
+        if( led < LED_START || led >= LED_COUNT ) return false;
+        pwm_t old = pwm[led];
+        if( !pwm_config(led, freq, bits) ) return false;
+        if( pwm[led].freq == old.freq && pwm[led].bits == old.bits && pwm[led].res == old.res ) return true;
+
+        uint8_t pin = channels[led].pin;
+        ledcDetach(pin);
+        bool ok = ledcAttach(pin, pwm[led].freq, pwm[led].res);
+        if( !ok ) {  // e.g. no ledc timer left for another frequency
+            pwm[led] = old;
+            ledcAttach(pin, old.freq, old.res);
+        }
+
+        // same brightness in the new range, continues from the target
+        uint32_t bit = 1 << led;
+        request[led] = value2duty(led, duty_value[led]);
+        duty[led] = power_apply(request[led], power_factor);  // same load fraction, same factor
+        fade_active &= ~bit;
+        output[led] = isOn ? duty[led] : 0;
+        output_dirty |= bit;
+        wave_output[led] = UINT32_MAX;
+        if( dithering ) dither_refresh();
+        #if defined(STAGGER)
+            hpoint[led] = UINT32_MAX;  // new ledc channel
+        #endif
+        update_hpoints();
+        write_outputs();
+        publish();
+        state_changed();
+        return ok;
+    #else
+        return false;
+    #endif
+}
+
+void app_load( led_t led, uint32_t mw ) {
+    AppLock lock;
+    if( led < LED_START || led >= LED_COUNT || mw == load_mw[led] ) return;
+    load_mw[led] = mw;
+    state_changed();
+    relimit(fade_ms);
+    update_hpoints();
+    write_outputs();
+    publish();
+}
+
+void app_budget( uint32_t mw ) {
+    AppLock lock;
+    if( mw == budget_mw ) return;
+    budget_mw = mw;
+    state_changed();
+    relimit(fade_ms);
+    update_hpoints();
+    write_outputs();
+    publish();
+}
+
+uint32_t get_load( led_t led ) {
+    return load_mw[led];
+}
+
+uint32_t get_budget() {
+    return budget_mw;
+}
+
+uint32_t get_load_mw() {
+    return target_mw;
+}
+
+uint32_t get_limit_pm() {
+    return ((uint64_t)power_factor * 1000) >> 16;
+}
+
+uint32_t get_energy_mwh( led_t led ) {
+    return power_mwh(energy[led]);
+}
+
+uint32_t get_freq( led_t led ) {
+    return pwm[led].freq;
+}
+
+uint8_t get_bits( led_t led ) {
+    return pwm[led].res;
+}
+
+uint32_t get_range( led_t led ) {
+    return pwm[led].range;
+}
+
+uint32_t get_fade() {
+    return fade_ms;
+}
+
+void app_curve( Fade::curve_t curve ) {
+    AppLock lock;
+    if( curve != fade_curve && curve < Fade::CURVE_COUNT ) {
+        fade_curve = curve;
+        state_changed();
     }
 }
 
+Fade::curve_t get_curve() {
+    return fade_curve;
+}
+
+uint32_t get_tick_us() {
+    return tick_us;
+}
+
 void setup_app( bool detach ) {
+    AppLock lock;
     prefs.begin(PROGNAME, false);
-    isOn = prefs.getBool("on", true);
-    int value[LED_COUNT];
-
+    load_state();
+    isOn = state.on;
+    fade_ms = state.fade_ms;
+    fade_curve = state.curve < Fade::CURVE_COUNT ? static_cast<Fade::curve_t>(state.curve) : Fade::EASE_IN_OUT;
+    budget_mw = state.budget_mw;
     for( int i = LED_START; i < LED_COUNT; i++ ) {
         led_t led = static_cast<led_t>(i);
-        value[led] = prefs.getInt(get_slider(i), 250);
+        load_mw[i] = state.channel[i].load_mw;
+        if( !pwm_config(led, state.channel[i].freq, state.channel[i].bits) ) {
+            pwm_config(led, PWM_FREQ, 0);  // e.g. saved on a chip with another ledc clock
+        }
+    }
+    publish();
+
+    app_frame_t frame;
+    app_begin(frame);
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        app_stage(frame, static_cast<led_t>(i), state.channel[i].value);
     }
+    app_commit(frame);
+
+    #if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(STRIP_PIN)
+        static bool strip_ready = false;
+        if( !strip_ready ) strip_ready = strip.begin();
+    #endif
 
     #if defined(ESP32)
-        for( int i = LED_START; i < LED_COUNT; i++ ) {
-            led_t led = static_cast<led_t>(i);
-            app_value(led, value[led]);
-            #if !defined(CONFIG_IDF_TARGET_ESP32S3)
-                if (detach) ledcDetach(PINS[led]);
-                ledcAttach(PINS[led], PWM_FREQ, PWMBITS);
-            #endif
-        }
+        #if !defined(CONFIG_IDF_TARGET_ESP32S3)
+            for( int i = LED_START; i < LED_COUNT; i++ ) {
+                if (detach) ledcDetach(channels[i].pin);
+                if( !ledcAttach(channels[i].pin, pwm[i].freq, pwm[i].res) ) {
+                    // out of ledc timers for another frequency: use the default
+                    pwm_config(static_cast<led_t>(i), PWM_FREQ, 0);
+                    ledcAttach(channels[i].pin, pwm[i].freq, pwm[i].res);
+                    request[i] = value2duty(static_cast<led_t>(i), duty_value[i]);
+                    duty[i] = power_apply(request[i], power_factor);
+                    fade_to(static_cast<led_t>(i), 0);
+                    publish();
+                }
+            }
+            uint8_t pins[LED_COUNT];
+            for( int i = LED_START; i < LED_COUNT; i++ ) {
+                pins[i] = channels[i].pin;
+            }
+            dithering = DUTY_SHIFT && dither_begin(pins, LED_COUNT);
+        #endif
     #else
         analogWriteRange(PWMRANGE);
         for( int i = LED_START; i < LED_COUNT; i++ ) {
-            led_t led = static_cast<led_t>(i);
-            pinMode(PINS[led], OUTPUT);
-            app_value(led, value[led]);
+            pinMode(channels[i].pin, OUTPUT);
+        }
+    #endif
+
+    output_dirty = (1 << LED_COUNT) - 1;  // pins are (re)attached now
+    write_outputs();
+    #if defined(STAGGER)
+        for( int i = LED_START; i < LED_COUNT; i++ ) {
+            hpoint[i] = UINT32_MAX;
+        }
+    #endif
+    update_hpoints();
+
+    #if defined(WAVE_TIMER)
+        static esp_timer_handle_t timer = NULL;
+        if( !timer ) {
+            // callback runs in the esp_timer task, not in an isr, so ledcWrite() is fine
+            esp_timer_create_args_t args = {};
+            args.callback = wave_timer;
+            args.dispatch_method = ESP_TIMER_TASK;
+            args.name = "waves";
+            if( esp_timer_create(&args, &timer) == ESP_OK ) {
+                esp_timer_start_periodic(timer, WAVE_TICK_MS * 1000);
+            }
+        }
+        for( uint32_t mask = wave_mask; mask; mask &= mask - 1 ) {
+            wave_output[__builtin_ctz(mask)] = UINT32_MAX;  // rewrite after attach
         }
     #endif
 }
 
 const char *get_slider( int led ) {
-    slider[sizeof(slider)-2] = '0' + led;  // up to 10 sliders
+    static char slider[12];
+    snprintf(slider, sizeof(slider), "slider%d", led);
     return slider;
 }
 
-bool handle_app() {
-    for( int i = LED_START; i < LED_COUNT; i++ ) {
-        led_t led = static_cast<led_t>(i);
-        if( duty_dirty[led] && millis() - duty_dirty[led] > 1000 ) {
-            // duty was last changed more than a second ago: save now
-            prefs.putInt(get_slider(i), duty_value[led]);
-            duty_dirty[led] = 0;
+const char *get_id( led_t led ) {
+    return channels[led].id;
+}
+
+const char *get_name( led_t led ) {
+    return channels[led].name;
+}
+
+uint8_t get_group( led_t led ) {
+    return channels[led].group;
+}
+
+int find_channel( const char *name, size_t len ) {
+    if( !len ) return -1;
+
+    size_t i = 0;
+    int index = 0;
+    while( i < len && name[i] >= '0' && name[i] <= '9' && index < LED_COUNT ) {
+        index = index * 10 + name[i++] - '0';
+    }
+    if( i == len ) return index < LED_COUNT ? index : -1;
+
+    int found = -1;
+    for( int led = LED_START; led < LED_COUNT; led++ ) {
+        const char *n = channels[led].name;
+        if( strncasecmp(n, name, len) == 0 ) {
+            if( !n[len] ) return led;  // exact match
+            found = (found < 0) ? led : LED_COUNT;  // prefix, must be unique
         }
     }
-    if( status_dirty && millis() - status_dirty > 1000 ) {
-        // isOn was last changed more than a second ago: save now
-        prefs.putBool("on", isOn);
-        status_dirty = 0;
+    return found < LED_COUNT ? found : -1;
+}
+
+bool handle_app() {
+    AppLock lock;
+    #if !defined(WAVE_TIMER)
+        wave_tick();
+    #endif
+    fade_tick();
+    integrate_energy();
+
+    if( state_dirty && millis() - state_dirty > STATE_QUIET_MS ) {
+        // state was last changed more than the quiet period ago: save now
+        save_state();
+        state_dirty = 0;
     }
     return true;
 }
 
-bool app_status( bool status ) {
+bool app_status( bool status, uint32_t ms ) {
+    AppLock lock;
     if( status ) {  // button state changed to pressed -> toggle on/off
-        isOn = !isOn;
-        status_dirty = millis();  // start to accumulate rapid changes to save flash.
-        if( !status_dirty ) status_dirty--;  // Make sure update time is never set to 0
-        for( int i = LED_START; i < LED_COUNT; i++ ) {
-            led_t led = static_cast<led_t>(i);
-            if( isOn ) {
-                set_duty(led, duty[led]);
-            }
-            else {
-                set_duty(led, 0);
-            }
-        }
+        app_frame_t frame;
+        app_begin(frame);
+        app_stage_power(frame, !isOn);
+        app_commit(frame, ms);
     }
     return isOn;
 }
 
 uint8_t get_pin( led_t led ) {
-    #if defined(CONFIG_IDF_TARGET_ESP32S3)
-        return pin;
-    #else
-        return PINS[led];
-    #endif
+    return channels[led].pin;
+}
+
+void app_snapshot( app_snapshot_t &s ) {
+    snapshot.read(s);
 }
 
 int get_value( led_t led ) {
-    return duty_value[led];
+    app_snapshot_t s;
+    snapshot.read(s);
+    return s.value[led];
 }
 
 int get_duty( led_t led ) {
-    return duty[led];
+    app_snapshot_t s;
+    snapshot.read(s);
+    return s.duty[led];
 }
 
-const char *get_duties() {
-    static char duties[LED_COUNT * 6];
-    char *str = duties;
-    bool sep = false;
-    for( int i = LED_START; i < LED_COUNT; i++ ) {
-        led_t led = static_cast<led_t>(i);
-        int n = snprintf(str, sizeof(duties) - (str - duties) - 1, "%s%d", sep ? "," : "", (int)duty[led]);
-        str += n;
-        sep = true;
+const char *get_duties( const app_snapshot_t &s, char *buf, size_t maxlen ) {
+    size_t len = 0;
+    *buf = '\0';
+    for( int i = LED_START; i < LED_COUNT && len < maxlen; i++ ) {
+        len += snprintf(buf + len, maxlen - len, "%s%u", i > LED_START ? "," : "", s.duty[i]);
     }
-    return duties;
+    return buf;
 }
 
+#if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(STRIP_PIN)
+Strip *get_strip() {
+    return &strip;
+}
+#else
+Strip *get_strip() {
+    return NULL;
+}
+#endif
+
 bool get_power() {
-    return isOn;
+    app_snapshot_t s;
+    snapshot.read(s);
+    return s.on;
+}
+
+uint32_t get_saves() {
+    return state.writes;
+}
+
+uint32_t get_wear_ppm() {
+    // entries per save: blob index, blob data header and data
+    uint64_t entries = (uint64_t)state.writes * (2 + (sizeof(state_t) + NVS_ENTRY - 1) / NVS_ENTRY);
+    uint64_t erases = entries / (NVS_PAGE_ENTRIES * NVS_PAGES);  // per page
+    return erases * 1000000 / FLASH_ERASE_CYCLES;
 }
@@ -1,17 +1,97 @@
 #pragma once
 
-typedef enum { LED_START, LED_R = LED_START, LED_G, LED_B, LED_W, LED_COUNT } led_t;
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Channels.h>
+#include <Fade.h>
+#include <Waveform.h>
+
+class Strip;
+
+#ifndef FADE_MS
+#define FADE_MS 500  // default transition time for commands in ms
+#endif
+
+// One led per entry of the channel table, see Channels.h
+#define LED_ENUM(id, name, pin, curve, group) LED_##id,
+typedef enum { CHANNELS(LED_ENUM) LED_COUNT, LED_START = 0 } led_t;
+#undef LED_ENUM
+
+static_assert(LED_COUNT > 0 && LED_COUNT <= 31, "1 to 31 channels (mask bit 31 is power)");
 
 void setup_app( bool detach = false );
 bool handle_app();
 
-bool app_status( bool onOff );
-void app_value( led_t led, int value );
+// Staged changes of several channels and power, applied together by app_commit()
+// State changes are serialized, app_* may be called from the loop and the web server task
+typedef struct {
+    uint32_t mask;         // bit per staged led
+    int8_t power;          // -1 unchanged, 0 off, 1 on
+    int value[LED_COUNT];  // slider values 0..1000
+} app_frame_t;
+
+// transition times in ms, 0 switches immediately
+void app_begin( app_frame_t &frame );
+void app_stage( app_frame_t &frame, led_t led, int value );
+void app_stage_power( app_frame_t &frame, bool on );
+void app_commit( const app_frame_t &frame, uint32_t ms = 0 );  // one hardware update
+
+// Consistent copy of the committed state, safe to read from any task
+typedef struct {
+    uint32_t on;
+    int32_t value[LED_COUNT];  // slider values 0..1000
+    uint32_t duty[LED_COUNT];  // target pwm duty if on
+} app_snapshot_t;
+
+void app_snapshot( app_snapshot_t &snapshot );
+
+bool app_status( bool onOff, uint32_t ms = 0 );
+void app_value( led_t led, int value, uint32_t ms = 0 );
+void app_level( const app_snapshot_t &mix, int level, uint32_t ms = 0 );  // switch on, brightest value of mix is level
+void app_fade( uint32_t ms );  // set default transition time
+uint32_t get_fade();           // get default transition time
+void app_curve( Fade::curve_t curve );  // set easing of all transitions, saved with the state
+Fade::curve_t get_curve();
+
+// Let a waveform (see Waveform.h) drive the output instead of the slider value, min and max
+// are slider values. On ESP32 a timer updates it, so it stays smooth while the loop is blocked.
+// Changing a running wave keeps its phase, period_ms 0 stops it and fades back to the slider value.
+bool app_wave( led_t led, wave_shape_t shape, uint32_t period_ms, int min = 0, int max = 1000,
+    const uint16_t *table = NULL );
+uint32_t get_waves();  // bit per led driven by a waveform
+
+// Change pwm frequency and resolution of a channel (ESP32 ledc only), saved with the state.
+// Bits 0 picks the highest resolution the ledc clock allows at freq (see Pwm.h).
+// False if the resolution is not possible or no ledc timer is left for another frequency.
+bool app_pwm( led_t led, uint32_t freq, uint8_t bits = 0 );
+uint32_t get_freq( led_t led );   // pwm frequency in Hz
+uint8_t get_bits( led_t led );    // pwm resolution in use
+uint32_t get_range( led_t led );  // max pwm duty
+
+// Power budget (see Power.h): load model of a channel (power at full duty) and the limit of all channels
+// in mW, 0 for unknown or no limit. If the slider values (waves at their highest value) would draw
+// more than the budget, all duties are scaled down by the same factor. Saved with the state.
+void app_load( led_t led, uint32_t mw );
+void app_budget( uint32_t mw );
+uint32_t get_load( led_t led );  // load model in mW at full duty
+uint32_t get_budget();           // limit in mW
+uint32_t get_load_mw();          // load of the slider values before the limit
+uint32_t get_limit_pm();         // duty scale of the limit in per mille, 1000 if within the budget
+uint32_t get_energy_mwh( led_t led );  // energy of the load model since boot
 
-const char *get_slider( int led );
+const char *get_slider( int led );  // web form field name, "slider<led>"
+const char *get_id( led_t led );     // short id from the table, e.g. "R"
+const char *get_name( led_t led );   // channel name from the table
+uint8_t get_group( led_t led );
+int find_channel( const char *name, size_t len );  // index or (unique prefix of a) name, -1 if not found
 
 uint8_t get_pin( led_t led );
 int get_value( led_t led );  // slider value 0..1000
-int get_duty( led_t led );   // pwm duty value 0..1023
-const char *get_duties();
-bool get_power();
\ No newline at end of file
+int get_duty( led_t led );   // pwm duty value 0..get_range()
+const char *get_duties( const app_snapshot_t &s, char *buf, size_t maxlen );  // comma separated, returns buf
+bool get_power();
+Strip *get_strip();  // addressable led strip or NULL, see Strip.h
+uint32_t get_tick_us();  // max cpu time of one transition tick
+uint32_t get_saves();    // state records written to flash
+uint32_t get_wear_ppm(); // estimated flash wear of the nvs pages in ppm of erase cycles
\ No newline at end of file
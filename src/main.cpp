@@ -4,13 +4,15 @@ HTML Slider with server feedback on value changes to control PWM duty cycle (see
 Influx DB can be created with command influx -execute "create database PROGNAME"
 Monitors GPIO pin pulled to ground as key press
 Use builtin led to represent health status
-TODO
-* maybe use websocket?
+Sliders use a websocket on /ws for binary value frames, HTTP posts are kept as fallback
 */
 
 #include <Arduino.h>
 
 #include <app.h>
+#include <Strip.h>
+#include <Effects.h>
+#include <Dither.h>
 #include <FileSys.h>
 
 #include <WiFiManager.h>
@@ -108,24 +110,71 @@ const uint32_t health_err_interval = 1000;
 Breathing health_led(health_ok_interval, HEALTH_LED_PIN, HEALTH_LED_INVERTED, HEALTH_LED_CHANNEL);
 bool enabledBreathing = true;  // global flag to switch breathing animation on or off
 
+// Load button: click toggles, double click is full brightness, hold ramps the brightness
+#include <Button.h>
+Button button(BUTTON_PIN);
+#define BUTTON_RAMP_STEP 20  // slider steps per repeat: full range in 2 s
+
+// Main page streaming
+#include <Assets.h>
+#include <Template.h>
+#include <memory>
+
+// Event trace, enable with -DTRACE
+#include <Trace.h>
+
+// Loop handlers
+#include <Scheduler.h>
+Scheduler scheduler;
+void setup_tasks();  // registers the handlers, called by setup()
+
 // Infrastructure
 #include <Syslog.h>
+#include <Log.h>
 #include <FileSys.h>
 
 FileSys fileSys;
 
 // Web status page and OTA updater
-#define WEBSERVER_PORT 80
+#ifndef WEBSERVER_PORT
+    #define WEBSERVER_PORT 80
+#endif
 
 AsyncWebServer web_server(WEBSERVER_PORT);
 bool shouldReboot = false;  // after updates...
 
+// Websocket slider control
+// Binary frame: bytes 0-3 are a channel mask (bit n for led n, bit 31 for power),
+// bytes 4-5 a sequence number and then one 16 bit value per channel set
+// in the mask (slider 0..1000, power 0 or 1), all little endian.
+// Clients send changes, the server broadcasts the resulting state to all clients.
+AsyncWebSocket web_socket("/ws");
+
+#define WS_POWER_BIT 0x80000000
+#define WS_MAX_CLIENTS 8
+#define WS_HEADER 6
+#define WS_FRAME_MAX (WS_HEADER + 2 * (LED_COUNT + 1))
+
+// last accepted sequence per connected client, client ids only grow so they are looked up in full
+typedef struct {
+    uint32_t id;
+    uint16_t seq;
+    bool used;   // slot belongs to client id
+    bool valid;  // client has sent a frame already
+} ws_client_t;
+
+static ws_client_t ws_clients[WS_MAX_CLIENTS + 1];  // one more: a new client connects before the oldest is closed
+
 // Post to InfluxDB
+#include <Influx.h>
+
+Influx influx(INFLUX_SERVER, INFLUX_PORT, INFLUX_DB, PROGNAME);
 int influx_status = 0;
 time_t post_time = 0;
 
 // publish to mqtt broker
 #include <PubSubClient.h>
+#include <Commands.h>
 
 WiFiClient wifiMqtt;
 PubSubClient mqtt(wifiMqtt);
@@ -133,23 +182,55 @@ PubSubClient mqtt(wifiMqtt);
 // Syslog
 WiFiUDP logUDP;
 Syslog syslog(logUDP, SYSLOG_PROTO_IETF);
-char msg[512];  // one buffer for all syslog and json messages
+// One buffer for all syslog and json messages: json_Pwm needs up to 29 bytes per channel plus
+// about 300, json_Tasks about 700
+#define MSG_SIZE (1024 + 32 * LED_COUNT)
+char msg[MSG_SIZE];
 
 char start_time[30];
 
 
+// Log messages are queued and written to serial and syslog by task_log()
+Log logger;
+bool log_infos = true;  // log infos only for first 10 minutes
+
 void slog(const char *message, uint16_t pri = LOG_INFO) {
-    static bool log_infos = true;
-    
     if (pri < LOG_INFO || log_infos) {
-        Serial.println(message);
-        syslog.log(pri, message);
+        logger.add(pri, message);
+    }
+}
+
+// Format directly into the log buffer, no shared message buffer needed
+void slogf(uint16_t pri, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void slogf(uint16_t pri, const char *format, ...) {
+    if (pri < LOG_INFO || log_infos) {
+        va_list args;
+        va_start(args, format);
+        logger.vprintf(pri, format, args);
+        va_end(args);
     }
+}
+
+void log_sink(uint16_t pri, const char *message) {
+    Serial.println(message);
+    syslog.log(pri, message);
+}
+
+void handle_log() {
+    static uint32_t prevDropped = 0;
 
     if (log_infos && millis() > 10 * 60 * 1000) {
-        log_infos = false;  // log infos only for first 10 minutes
+        log_infos = false;
         slog("Switch off info level messages", LOG_NOTICE);
     }
+
+    logger.drain(log_sink, 8);  // batch size, rest is drained in the next runs
+
+    uint32_t dropped = logger.dropped() + logger.limited();
+    if (dropped != prevDropped && logger.printf(LOG_WARNING, "Log dropped %u records (%u full, %u limited)",
+            dropped - prevDropped, logger.dropped(), logger.limited())) {
+        prevDropped = dropped;
+    }
 }
 
 
@@ -160,37 +241,41 @@ void publish( const char *topic, const char *payload ) {
 }
 
 
-// Post data to InfluxDB
+// Queue data for InfluxDB, sent in batches by the influx writer
 bool postInflux(const char *line) {
-    static const char uri[] = "/write?db=" INFLUX_DB "&precision=s";
+    return influx.add(line);
+}
+
+
+// Track influx writer status changes and send from loop if there is no sender task
+void handle_influx() {
+    static uint32_t prevDropped = 0;
 
-    WiFiClient wifiHttp;
-    HTTPClient http;
+    influx.handle();
 
-    http.begin(wifiHttp, INFLUX_SERVER, INFLUX_PORT, uri);
-    http.setUserAgent(PROGNAME);
     int prev = influx_status;
-    influx_status = http.POST(line);
-    String payload;
-    if (http.getSize() > 0) { // workaround for bug in getString()
-        payload = http.getString();
-    }
-    http.end();
+    influx_status = influx.status();
+    post_time = influx.last_post();
 
     if (influx_status != prev) {
         snprintf(msg, sizeof(msg), "%d", influx_status);
         publish(MQTT_TOPIC "/status/DBResponse", msg);
-    }
 
-    if (influx_status < 200 || influx_status >= 300) {
-        snprintf(msg, sizeof(msg), "Post %s:%d%s status=%d line='%s' response='%s'",
-            INFLUX_SERVER, INFLUX_PORT, uri, influx_status, line, payload.c_str());
-        slog(msg, LOG_ERR);
-        return false;
+        if (influx_status < 200 || influx_status >= 300) {
+            snprintf(msg, sizeof(msg), "Post %s:%d status=%d queued=%u",
+                INFLUX_SERVER, INFLUX_PORT, influx_status, influx.queued());
+            slog(msg, LOG_ERR);
+        }
     }
 
-    post_time = time(NULL);
-    return true;
+    uint32_t dropped = influx.dropped();
+    if (dropped != prevDropped) {
+        snprintf(msg, sizeof(msg), "%u", dropped);
+        publish(MQTT_TOPIC "/status/DBDropped", msg);
+        snprintf(msg, sizeof(msg), "Influx dropped %u points", dropped - prevDropped);
+        slog(msg, LOG_WARNING);
+        prevDropped = dropped;
+    }
 }
 
 
@@ -209,58 +294,166 @@ bool json_Wifi(char *json, size_t maxlen, const char *bssid, int8_t rssi) {
 
 
 // Wifi status as JSON
-bool json_Pwm(char *json, size_t maxlen, bool on) {
+bool json_Pwm(char *json, size_t maxlen) {
     static const char jsonFmt[] =
         "{\"Version\":" VERSION ",\"Hostname\":\"%s\",\"Pwm\":{"
         "\"Duties\":[%s],"
-        "\"Power\":%d}}";
+        "\"Freqs\":[%s],"
+        "\"Bits\":[%s],"
+        "\"EnergyMwh\":[%s],"
+        "\"LoadMw\":%u,"
+        "\"BudgetMw\":%u,"
+        "\"LimitPm\":%u,"
+        "\"Power\":%d,"
+        "\"Fade\":%u,"
+        "\"Curve\":\"%s\","
+        "\"TickUs\":%u,"
+        "\"Saves\":%u,"
+        "\"WearPpm\":%u}}";
     
 
-    int len = snprintf(json, maxlen, jsonFmt, hostname(), get_duties(), get_power() ? 1 : 0);
+    app_snapshot_t state;
+    app_snapshot(state);
+    // max digits per channel plus separator: duty 65535, freq 40000000 Hz, bits 16, energy 4294967295 mWh
+    char duties[LED_COUNT * 6];
+    char freqs[LED_COUNT * 9];
+    char bits[LED_COUNT * 3];
+    char energy[LED_COUNT * 11];
+    size_t f = 0, b = 0, e = 0;
+    freqs[0] = bits[0] = energy[0] = '\0';
+    for (int i = LED_START; i < LED_COUNT && f < sizeof(freqs) && b < sizeof(bits) && e < sizeof(energy); i++) {
+        led_t led = static_cast<led_t>(i);
+        const char *sep = i > LED_START ? "," : "";
+        f += snprintf(freqs + f, sizeof(freqs) - f, "%s%u", sep, get_freq(led));
+        if (f < sizeof(freqs)) b += snprintf(bits + b, sizeof(bits) - b, "%s%u", sep, get_bits(led));
+        if (b < sizeof(bits)) e += snprintf(energy + e, sizeof(energy) - e, "%s%u", sep, get_energy_mwh(led));
+    }
+    if (f >= sizeof(freqs) || b >= sizeof(bits) || e >= sizeof(energy)) return false;
+
+    int len = snprintf(json, maxlen, jsonFmt, hostname(), get_duties(state, duties, sizeof(duties)), freqs, bits,
+        energy, get_load_mw(), get_budget(), get_limit_pm(),
+        state.on ? 1 : 0, get_fade(), Fade::name(get_curve()), get_tick_us(), get_saves(), get_wear_ppm());
+
+    return len >= 0 && (size_t)len < maxlen;
+}
+
+
+// Effect parameters and renderer statistics as JSON
+bool json_Effect(char *json, size_t maxlen) {
+    static const char jsonFmt[] =
+        "{\"Version\":" VERSION ",\"Hostname\":\"%s\",\"Effect\":{"
+        "\"Name\":\"%s\","
+        "\"Speed\":%u,"
+        "\"Size\":%u,"
+        "\"Brightness\":%u,"
+        "\"Color\":\"%02x%02x%02x%02x\","
+        "\"Color2\":\"%02x%02x%02x%02x\","
+        "\"Frames\":%u,"
+        "\"Dropped\":%u,"
+        "\"FrameUs\":%u,"
+        "\"LoadPm\":%u}}";
+
+    effect_params_t p;
+    effects_get(p);
+    int len = snprintf(json, maxlen, jsonFmt, hostname(), effects_name(p.effect), p.speed, p.size, p.brightness,
+        p.color[0], p.color[1], p.color[2], p.color[3], p.color2[0], p.color2[1], p.color2[2], p.color2[3],
+        effects_frames(), effects_dropped(), effects_frame_us(), effects_load_pm());
 
     return len < maxlen;
 }
 
 
+// Scheduler task statistics as JSON: name: [runs, missed deadlines, max us]
+// plus free heap and lowest free heap since boot (e.g. for tools/webbench.py)
+bool json_Tasks(char *json, size_t maxlen) {
+    #if defined(ESP32)
+        uint32_t minHeap = ESP.getMinFreeHeap();
+    #else
+        uint32_t minHeap = ESP.getFreeHeap();
+    #endif
+
+    int len = snprintf(json, maxlen, "{\"Version\":" VERSION ",\"Hostname\":\"%s\",\"Tasks\":{", hostname());
+    for (size_t i = 0; i < scheduler.count() && len < (int)maxlen; i++) {
+        len += snprintf(json + len, maxlen - len, "%s\"%s\":[%u,%u,%u]", i ? "," : "",
+            scheduler.name(i), scheduler.runs(i), scheduler.missed(i), scheduler.max_us(i));
+    }
+    if (len < (int)maxlen) {
+        len += snprintf(json + len, maxlen - len, "},\"Heap\":{\"Free\":%u,\"Min\":%u},"
+            "\"Log\":{\"Queued\":%u,\"Dropped\":%u,\"Limited\":%u,\"Truncated\":%u}",
+            ESP.getFreeHeap(), minHeap, logger.queued(), logger.dropped(), logger.limited(), logger.truncated());
+    }
+    Strip *strip = get_strip();
+    if (strip && len < (int)maxlen) {
+        // frames sent, show() calls while busy, max cpu us per show(), us per transmission, framebuffer bytes
+        len += snprintf(json + len, maxlen - len, ",\"Strip\":{\"Pixels\":%u,\"Frames\":%u,\"Busy\":%u,"
+            "\"ShowUs\":%u,\"SendUs\":%u,\"Ram\":%u}",
+            strip->pixels(), strip->frames(), strip->busy_count(), strip->show_us(), strip->send_us(), (unsigned)strip->ram());
+    }
+    if (len < (int)maxlen) {
+        // events, queue overflows, press to light ms (last, max), max ms from detection to light
+        len += snprintf(json + len, maxlen - len, ",\"Button\":{\"Events\":%u,\"Dropped\":%u,"
+            "\"LatencyMs\":%u,\"MaxLatencyMs\":%u,\"MaxWaitMs\":%u}",
+            button.events(), button.dropped(), button.latency_ms(), button.max_latency_ms(), button.max_wait_ms());
+    }
+    if (dither_tick_us() && len < (int)maxlen) {
+        // max cpu us of a dither tick, average ns per channel and tick
+        len += snprintf(json + len, maxlen - len, ",\"Dither\":{\"Bits\":%u,\"TickUs\":%u,\"ChannelNs\":%u}",
+            DITHER_BITS, dither_tick_us(), dither_channel_ns());
+    }
+    if (len < (int)maxlen) {
+        len += snprintf(json + len, maxlen - len, "}");
+    }
+
+    return len < (int)maxlen;
+}
+
+
 // Report a change of duty or power
-void report_pwm( bool on ) {
-    static const char lineFmt[] =
-        "Pwm,Host=%s,Version=" VERSION " "
-        "DutyR=%d,"
-        "DutyG=%d,"
-        "DutyB=%d,"
-        "DutyW=%d,"
-        "Power=%d";
+void report_pwm() {
     static const uint32_t interval = 60000;
     static uint32_t prev_ms = 0;
     static uint32_t changed_ms = 0;
-    static int prevDuty[LED_COUNT] = { -1, -1, -1, -1 };
+    static uint32_t prevDuty[LED_COUNT];
     static bool prevPower = false;
 
     if (!WiFi.isConnected()) return;
 
     uint32_t now = millis();
+    app_snapshot_t state;
+    app_snapshot(state);
+    bool on = state.on;
 
     // rate limit changes
-    for( int i = LED_START; i < LED_COUNT; i++ ) {
-        led_t led = static_cast<led_t>(i);
-
-        if (get_duty(led) != prevDuty[led] || on != prevPower) {
-            changed_ms = now;
-            if (!changed_ms) changed_ms--;
-            prevDuty[led] = get_duty(led);
-            prevPower = on;
-        }
+    if (on != prevPower || memcmp(state.duty, prevDuty, sizeof(prevDuty)) != 0) {
+        changed_ms = now;
+        if (!changed_ms) changed_ms--;
+        memcpy(prevDuty, state.duty, sizeof(prevDuty));
+        prevPower = on;
     }
 
     if ( (changed_ms && now - changed_ms > 1000) || (now - prev_ms > interval) ) {
-        json_Pwm(msg, sizeof(msg), on);
-        slog(msg);
-        publish(MQTT_TOPIC "/json/Pwm", msg);
-
-        snprintf(msg, sizeof(msg), lineFmt, hostname(), 
-            get_duty(LED_R), get_duty(LED_G), get_duty(LED_B), get_duty(LED_W), on);
-        postInflux(msg);
+        TRACE_BEGIN("report pwm");
+        // log records are short, the full json goes to mqtt only
+        char duties[6 * LED_COUNT];
+        slogf(LOG_INFO, "Pwm %s duties %s limit %u", on ? "on" : "off", get_duties(state, duties, sizeof(duties)),
+            get_limit_pm());
+        if (json_Pwm(msg, sizeof(msg))) publish(MQTT_TOPIC "/json/Pwm", msg);
+
+        // fields DutyR=...,DutyG=...,WhR=...,Power=... from the channel table, energy only with a load model
+        int len = snprintf(msg, sizeof(msg), "Pwm,Host=%s,Version=" VERSION " ", hostname());
+        for( int i = LED_START; i < LED_COUNT && len < (int)sizeof(msg); i++ ) {
+            led_t led = static_cast<led_t>(i);
+            len += snprintf(msg + len, sizeof(msg) - len, "Duty%s=%u,", get_id(led), state.duty[i]);
+            if (get_load(led) && len < (int)sizeof(msg)) {
+                uint32_t mwh = get_energy_mwh(led);
+                len += snprintf(msg + len, sizeof(msg) - len, "Wh%s=%u.%03u,", get_id(led), mwh / 1000, mwh % 1000);
+            }
+        }
+        if (len < (int)sizeof(msg)) {
+            snprintf(msg + len, sizeof(msg) - len, "Power=%d", on);
+            postInflux(msg);
+        }
+        TRACE_END("report pwm");
 
         prev_ms = now;
         changed_ms = 0;
@@ -298,8 +491,8 @@ void report_wifi( int8_t rssi, const byte *bssid ) {
     }
     uint32_t now = millis();
     if (diff >= min_diff || (now - prev > interval) ) {
+        slogf(LOG_INFO, "Wifi BSSID %s RSSI %d", lastBssid, lastRssi);
         json_Wifi(msg, sizeof(msg), lastBssid, lastRssi);
-        slog(msg);
         publish(MQTT_TOPIC "/json/Wifi", msg);
 
         snprintf(msg, sizeof(msg), lineFmt, hostname(), lastBssid, WiFi.localIP().toString().c_str(), lastRssi);
@@ -369,269 +562,415 @@ bool handle_wifi() {
 
 char web_msg[80] = "";  // main web page displays and then clears this
 
-// Standard web page
-const char *main_page() {
-    static const char fmt[] =
-        "<!doctype html>\n"
-        "<html lang=\"en\">\n"
-        " <head>\n"
-        "  <meta charset=\"utf-8\">\n"
-        "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n"
-        "  <link href=\"data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAAABAAAAAQAgMAAABinRfyAAAADFBMVEUqYbutnpTMuq/70SQgIef5AAAAVUlEQVQIHWOAAPkvDAyM3+Y7MLA7NV5g4GVqKGCQYWowYTBhapBhMGB04GE4/0X+M8Pxi+6XGS67XzzO8FH+iz/Dl/q/8gx/2S/UM/y/wP6f4T8QAAB3Bx3jhPJqfQAAAABJRU5ErkJggg==\" rel=\"icon\" type=\"image/x-icon\" />\n"
-        "  <link href=\"bootstrap.min.css\" rel=\"stylesheet\">\n"
-        "  <title>" PROGNAME " v" VERSION "</title>\n"
-        " </head>\n"
-        " <body>\n"
-        "  <div class=\"container\">\n"
-        "   <form action=\"/change\" method=\"post\" enctype=\"multipart/form-data\" id=\"form\">\n"
-        "    <div class=\"row\">\n"
-        "     <div class=\"col-12\">\n"
-        "      <h1>" PROGNAME " v" VERSION "</h1>\n"
-        "     </div>\n"
-        "    </div>\n"
-        "    <div class=\"row my-4\">\n"
-        "     <div class=\"col-10\">\n"
-        "      <input style=\"width:100%%\" id=\"slider0\" type=\"range\" min=\"0\" max=\"1000\" step=\"1\" value=\"%d\">\n"
-        "     </div>\n"
-        "     <div class=\"col-2\">\n"
-        "      <div class=\"float-end\" id=\"sliderValue0\">%d</div>\n"
-        "     </div>\n"
-        "    </div>\n"
-        "    <div class=\"row my-4\">\n"
-        "     <div class=\"col-10\">\n"
-        "      <input style=\"width:100%%\" id=\"slider1\" type=\"range\" min=\"0\" max=\"1000\" step=\"1\" value=\"%d\">\n"
-        "     </div>\n"
-        "     <div class=\"col-2\">\n"
-        "      <div class=\"float-end\" id=\"sliderValue1\">%d</div>\n"
-        "     </div>\n"
-        "    </div>\n"
-        "    <div class=\"row my-4\">\n"
-        "     <div class=\"col-10\">\n"
-        "      <input style=\"width:100%%\" id=\"slider2\" type=\"range\" min=\"0\" max=\"1000\" step=\"1\" value=\"%d\">\n"
-        "     </div>\n"
-        "     <div class=\"col-2\">\n"
-        "      <div class=\"float-end\" id=\"sliderValue2\">%d</div>\n"
-        "     </div>\n"
-        "    </div>\n"
-        "    <div class=\"row my-4\">\n"
-        "     <div class=\"col-10\">\n"
-        "      <input style=\"width:100%%\" id=\"slider3\" type=\"range\" min=\"0\" max=\"1000\" step=\"1\" value=\"%d\">\n"
-        "     </div>\n"
-        "     <div class=\"col-2\">\n"
-        "      <div class=\"float-end\" id=\"sliderValue3\">%d</div>\n"
-        "     </div>\n"
-        "    </div>\n"
-        "    <div class=\"row my-4\">\n"
-        "     <div class=\"col-2\" mr-auto>\n"
-        "      <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"button-1\">Toggle</button>\n"
-        "     </div>\n"
-        "     <div class=\"col-8\"></div>\n"
-        "    </div>\n"
-        "   </form>\n"
-        "   <div class=\"accordion\" id=\"infos\">\n"
-        "    <div class=\"accordion-item\">\n"
-        "     <h2 class=\"accordion-header\" id=\"heading1\">\n"
-        "      <button class=\"accordion-button\" type=\"button\" data-bs-toggle=\"collapse\" data-bs-target=\"#infos1\" aria-expanded=\"true\" aria-controls=\"infos1\">\n"
-        "       Infos\n"
-        "      </button>\n"
-        "     </h2>\n"
-        "     <div id=\"infos1\" class=\"accordion-collapse collapse\" aria-labelledby=\"heading1\" data-bs-parent=\"#infos\">\n"
-        "      <div class=\"accordion-body\">\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"pwm\">Pwm</label></div>\n"
-        "        <div class=\"col\" id=\"pwm\"><a href=\"/json/Pwm\">JSON</a></div>\n"
-        "       </div>\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"wifi\">Wifi</label></div>\n"
-        "        <div class=\"col\" id=\"wifi\"><a href=\"/json/Wifi\">JSON</a></div>\n"
-        "       </div>\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"update\">Post firmware image to</label></div>\n"
-        "        <div class=\"col\" id=\"update\"><a href=\"/update\">/update</a></div>\n"
-        "       </div>\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"start\">Last start time</label></div>\n"
-        "        <div class=\"col\" id=\"start\">%s</div>\n"
-        "       </div>\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"web\">Last web update</label></div>\n"
-        "        <div class=\"col\" id=\"web\">%s</div>\n"
-        "       </div>\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"influx\">Last influx update</label></div>\n"
-        "        <div class=\"col\" id=\"influx\">%s</div>\n"
-        "       </div>\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"status\">Influx status</label></div>\n"
-        "        <div class=\"col\" id=\"status\">%d</div>\n"
-        "       </div>\n"
-        "       <div class=\"row\">\n"
-        "        <div class=\"col\"><label for=\"rssi\">RSSI %s</label></div>\n"
-        "        <div class=\"col\" id=\"rssi\">%d</div>\n"
-        "       </div>\n"
-        "       <div class=\"row mt-4\">\n"
-        "        <div class=\"col\">\n"
-        "         <form action=\"breathe\" method=\"post\">\n"
-        "          <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"breathe\">Toggle Breath</button>\n"
-        "         </form>\n"
-        "        </div>\n"
-        "        <div class=\"col\">\n"
-        "         <form action=\"wipe\" method=\"post\">\n"
-        "          <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"wipe\">Wipe WLAN</button>\n"
-        "         </form>\n"
-        "        </div>\n"
-        "        <div class=\"col\">\n"
-        "         <form action=\"reset\" method=\"post\">\n"
-        "          <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"reset\">Reset ESP</button>\n"
-        "         </form>\n"
-        "        </div>\n"
-        "       </div>\n"
-        "      </div>\n"
-        "     </div>\n"
-        "    </div>\n"
-        "   </div>\n"
-        "   <div class=\"alert alert-primary alert-dismissible fade show\" role=\"alert\">\n"
-        "    <strong>Status</strong> %s\n"
-        "    <button type=\"button\" class=\"btn-close\" data-bs-dismiss=\"alert\" aria-label=\"Close\">\n"
-        "     <span aria-hidden=\"true\"></span>\n"
-        "    </button>\n"
-        "   </div>\n"
-        "   <div class=\"row\"><small>... by <a href=\"https://github.com/joba-1\">Joachim Banzhaf</a>, " __DATE__ " " __TIME__ "</small></div>\n"
-        "  </div>\n"
-        "  <script src=\"jquery.min.js\"></script>\n"
-        "  <script src=\"bootstrap.bundle.min.js\"></script>\n"
-        "  <script src=\"slider.js\"></script>\n"
-        "  <script>\n"
-        "   sliderCallback('slider0', 'sliderValue0', '/r');\n"
-        "   sliderCallback('slider1', 'sliderValue1', '/g');\n"
-        "   sliderCallback('slider2', 'sliderValue2', '/b');\n"
-        "   sliderCallback('slider3', 'sliderValue3', '/w');\n"
-        "  </script>\n"
-        " </body>\n"
-        "</html>\n";
-    static char page[sizeof(fmt) + 500] = "";
-    static char curr_time[30], influx_time[30];
-    time_t now;
-    time(&now);
-    strftime(curr_time, sizeof(curr_time), "%FT%T", localtime(&now));
-    strftime(influx_time, sizeof(influx_time), "%FT%T", localtime(&post_time));
+// Standard web page template, see main_vars for placeholders
+static const char main_page[] PROGMEM =
+    "<!doctype html>\n"
+    "<html lang=\"en\">\n"
+    " <head>\n"
+    "  <meta charset=\"utf-8\">\n"
+    "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n"
+    "  <link href=\"data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAAABAAAAAQAgMAAABinRfyAAAADFBMVEUqYbutnpTMuq/70SQgIef5AAAAVUlEQVQIHWOAAPkvDAyM3+Y7MLA7NV5g4GVqKGCQYWowYTBhapBhMGB04GE4/0X+M8Pxi+6XGS67XzzO8FH+iz/Dl/q/8gx/2S/UM/y/wP6f4T8QAAB3Bx3jhPJqfQAAAABJRU5ErkJggg==\" rel=\"icon\" type=\"image/x-icon\" />\n"
+    "  <link href=\"" ASSET_BOOTSTRAP_CSS "\" rel=\"stylesheet\">\n"
+    "  <title>" PROGNAME " v" VERSION "</title>\n"
+    " </head>\n"
+    " <body>\n"
+    "  <div class=\"container\">\n"
+    "   <form action=\"/change\" method=\"post\" enctype=\"multipart/form-data\" id=\"form\">\n"
+    "    <div class=\"row\">\n"
+    "     <div class=\"col-12\">\n"
+    "      <h1>" PROGNAME " v" VERSION "</h1>\n"
+    "     </div>\n"
+    "    </div>\n"
+    "    <div id=\"sliders\"></div>\n"
+    "    <div class=\"row my-4\">\n"
+    "     <div class=\"col-2\" mr-auto>\n"
+    "      <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"button-1\">Toggle</button>\n"
+    "     </div>\n"
+    "     <div class=\"col-8\"></div>\n"
+    "    </div>\n"
+    "   </form>\n"
+    "   <div class=\"accordion\" id=\"infos\">\n"
+    "    <div class=\"accordion-item\">\n"
+    "     <h2 class=\"accordion-header\" id=\"heading1\">\n"
+    "      <button class=\"accordion-button\" type=\"button\" data-bs-toggle=\"collapse\" data-bs-target=\"#infos1\" aria-expanded=\"true\" aria-controls=\"infos1\">\n"
+    "       Infos\n"
+    "      </button>\n"
+    "     </h2>\n"
+    "     <div id=\"infos1\" class=\"accordion-collapse collapse\" aria-labelledby=\"heading1\" data-bs-parent=\"#infos\">\n"
+    "      <div class=\"accordion-body\">\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"pwm\">Pwm</label></div>\n"
+    "        <div class=\"col\" id=\"pwm\"><a href=\"/json/Pwm\">JSON</a></div>\n"
+    "       </div>\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"wifi\">Wifi</label></div>\n"
+    "        <div class=\"col\" id=\"wifi\"><a href=\"/json/Wifi\">JSON</a></div>\n"
+    "       </div>\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"update\">Post firmware image to</label></div>\n"
+    "        <div class=\"col\" id=\"update\"><a href=\"/update\">/update</a></div>\n"
+    "       </div>\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"start\">Last start time</label></div>\n"
+    "        <div class=\"col\" id=\"start\">%start%</div>\n"
+    "       </div>\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"web\">Last web update</label></div>\n"
+    "        <div class=\"col\" id=\"web\">%now%</div>\n"
+    "       </div>\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"influx\">Last influx update</label></div>\n"
+    "        <div class=\"col\" id=\"influx\">%influx%</div>\n"
+    "       </div>\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"status\">Influx status</label></div>\n"
+    "        <div class=\"col\" id=\"status\">%status%</div>\n"
+    "       </div>\n"
+    "       <div class=\"row\">\n"
+    "        <div class=\"col\"><label for=\"rssi\">RSSI %bssid%</label></div>\n"
+    "        <div class=\"col\" id=\"rssi\">%rssi%</div>\n"
+    "       </div>\n"
+    "       <div class=\"row mt-4\">\n"
+    "        <div class=\"col\">\n"
+    "         <form action=\"breathe\" method=\"post\">\n"
+    "          <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"breathe\">Toggle Breath</button>\n"
+    "         </form>\n"
+    "        </div>\n"
+    "        <div class=\"col\">\n"
+    "         <form action=\"wipe\" method=\"post\">\n"
+    "          <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"wipe\">Wipe WLAN</button>\n"
+    "         </form>\n"
+    "        </div>\n"
+    "        <div class=\"col\">\n"
+    "         <form action=\"reset\" method=\"post\">\n"
+    "          <button class=\"btn btn-primary\" button type=\"submit\" name=\"button\" value=\"reset\">Reset ESP</button>\n"
+    "         </form>\n"
+    "        </div>\n"
+    "       </div>\n"
+    "      </div>\n"
+    "     </div>\n"
+    "    </div>\n"
+    "   </div>\n"
+    "   <div class=\"alert alert-primary alert-dismissible fade show\" role=\"alert\">\n"
+    "    <strong>Status</strong> %msg%\n"
+    "    <button type=\"button\" class=\"btn-close\" data-bs-dismiss=\"alert\" aria-label=\"Close\">\n"
+    "     <span aria-hidden=\"true\"></span>\n"
+    "    </button>\n"
+    "   </div>\n"
+    "   <div class=\"row\"><small>... by <a href=\"https://github.com/joba-1\">Joachim Banzhaf</a>, " __DATE__ " " __TIME__ "</small></div>\n"
+    "  </div>\n"
+    "  <script src=\"" ASSET_JQUERY_JS "\"></script>\n"
+    "  <script src=\"" ASSET_BOOTSTRAP_JS "\"></script>\n"
+    "  <script src=\"" ASSET_SLIDER_JS "\"></script>\n"
+    "  <script>\n"
+    "   sliderTable('sliders', %channels%, '/change');\n"
+    "  </script>\n"
+    " </body>\n"
+    "</html>\n";
+
+// Placeholder callbacks for main_page
+// channel names and slider values as JSON: [["red",250],...]
+static int fill_channels( char *buf, size_t maxlen ) {
+    app_snapshot_t state;
+    app_snapshot(state);
+    int len = snprintf(buf, maxlen, "[");
+    for( int i = LED_START; i < LED_COUNT && len < (int)maxlen; i++ ) {
+        len += snprintf(buf + len, maxlen - len, "%s[\"%s\",%d]", i ? "," : "", get_name(static_cast<led_t>(i)), (int)state.value[i]);
+    }
+    if( len < (int)maxlen ) {
+        len += snprintf(buf + len, maxlen - len, "]");
+    }
+    return len;
+}
+
+static int fill_time( char *buf, size_t maxlen, time_t t ) {
+    struct tm tm;
+    char str[30];
+    strftime(str, sizeof(str), "%FT%T", localtime_r(&t, &tm));
+    return snprintf(buf, maxlen, "%s", str);
+}
+
+static const Template::var_t main_vars[] = {
+    { "channels", fill_channels },
+    { "start",  []( char *buf, size_t maxlen ) { return snprintf(buf, maxlen, "%s", start_time); } },
+    { "now",    []( char *buf, size_t maxlen ) { return fill_time(buf, maxlen, time(NULL)); } },
+    { "influx", []( char *buf, size_t maxlen ) { return fill_time(buf, maxlen, post_time); } },
+    { "status", []( char *buf, size_t maxlen ) { return snprintf(buf, maxlen, "%d", influx_status); } },
+    { "bssid",  []( char *buf, size_t maxlen ) { return snprintf(buf, maxlen, "%s", lastBssid); } },
+    { "rssi",   []( char *buf, size_t maxlen ) { return snprintf(buf, maxlen, "%d", lastRssi); } },
+    { "msg",    []( char *buf, size_t maxlen ) {
+        int len = snprintf(buf, maxlen, "%s", web_msg);
+        if (len < (int)maxlen) *web_msg = '\0';  // shown once
+        return len; } }
+};
+
+static const Template main_template(main_page, main_vars, sizeof(main_vars) / sizeof(*main_vars));
+
+// Stream main page in chunks, each request keeps its own template position
+void send_main_page( AsyncWebServerRequest *request, int code = 200 ) {
     if( !*web_msg && (influx_status < 200 || influx_status >= 300 ) ) {
-        snprintf(web_msg, sizeof(web_msg), "WARNING: %s",
-            (influx_status < 200 || influx_status >= 300) ? "Database" : "");
+        snprintf(web_msg, sizeof(web_msg), "WARNING: %s", "Database");
+    }
+    std::shared_ptr<size_t> pos = std::make_shared<size_t>(0);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/html",
+        [pos](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return main_template.render((char *)buffer, maxLen, *pos);
+        });
+    response->setCode(code);
+    request->send(response);
+}
+
+// Encode current slider values and power as websocket frame, return frame length
+size_t ws_state( uint8_t *frame, uint16_t seq ) {
+    app_snapshot_t state;
+    app_snapshot(state);
+    uint32_t mask = WS_POWER_BIT | ((1u << LED_COUNT) - 1);
+    uint8_t *val = frame + WS_HEADER;
+    for( int i = 0; i < 4; i++ ) {
+        frame[i] = mask >> (8 * i);
+    }
+    frame[4] = seq & 0xff;
+    frame[5] = seq >> 8;
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        int value = state.value[i];
+        *(val++) = value & 0xff;
+        *(val++) = value >> 8;
+    }
+    *(val++) = state.on ? 1 : 0;
+    *(val++) = 0;
+    return val - frame;
+}
+
+// Sequence slot of a client id, a free one is taken if add is set, NULL if there is none
+ws_client_t *ws_client( uint32_t id, bool add ) {
+    ws_client_t *slot = NULL;
+    for (ws_client_t &c : ws_clients) {
+        if (c.used && c.id == id) return &c;
+        if (!c.used && !slot) slot = &c;
+    }
+    if (add && slot) {
+        *slot = { id, 0, true, false };
+        return slot;
+    }
+    return NULL;
+}
+
+// Apply a binary websocket frame from a client (see AsyncWebSocket web_socket)
+// Frames with a sequence number not newer than the last one of the client are dropped,
+// so values overtaken on the way do not win over the latest value
+void ws_frame( AsyncWebSocketClient *client, const uint8_t *data, size_t len ) {
+    if (len < WS_HEADER) return;
+
+    uint32_t mask = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    uint16_t seq = data[4] | (data[5] << 8);
+    ws_client_t *c = ws_client(client->id(), true);
+    if (c) {
+        if (c->valid && (int16_t)(seq - c->seq) <= 0) return;
+        c->seq = seq;
+        c->valid = true;
+    }  // else no slot left: applied unordered rather than dropped
+
+    app_frame_t frame;
+    app_begin(frame);
+    const uint8_t *val = data + WS_HEADER;
+    const uint8_t *end = data + len;
+    for( uint32_t leds = mask & ((1u << LED_COUNT) - 1); leds; leds &= leds - 1 ) {
+        if (val + 2 > end) return;
+        app_stage(frame, static_cast<led_t>(__builtin_ctz(leds)), val[0] | (val[1] << 8));
+        val += 2;
+    }
+    if (mask & WS_POWER_BIT) {
+        if (val + 2 > end) return;
+        app_stage_power(frame, (val[0] | (val[1] << 8)) != 0);
+    }
+    app_commit(frame);
+}
+
+void ws_event( AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len ) {
+    if (type == WS_EVT_CONNECT) {
+        uint8_t frame[WS_FRAME_MAX];
+        ws_client(client->id(), true);
+        client->binary(frame, ws_state(frame, 0));
+    }
+    else if (type == WS_EVT_DISCONNECT) {
+        ws_client_t *c = ws_client(client->id(), false);
+        if (c) c->used = false;
+    }
+    else if (type == WS_EVT_DATA) {
+        AwsFrameInfo *info = (AwsFrameInfo *)arg;
+        // slider frames are tiny, so fragmented messages are not expected
+        if (info->final && info->index == 0 && info->len == len && info->opcode == WS_BINARY) {
+            TRACE_BEGIN("ws frame");
+            ws_frame(client, data, len);
+            TRACE_END("ws frame");
+        }
+    }
+}
+
+// Broadcast slider and power changes to all websocket clients
+// Scheduled periodically, so changes are coalesced to at most one frame per period
+void handle_ws() {
+    static uint16_t seq = 0;
+    static int32_t prevValue[LED_COUNT];
+    static bool prevPower = false;
+
+    web_socket.cleanupClients(WS_MAX_CLIENTS);
+
+    app_snapshot_t state;
+    app_snapshot(state);
+    bool changed = (bool)state.on != prevPower || memcmp(state.value, prevValue, sizeof(prevValue)) != 0;
+    memcpy(prevValue, state.value, sizeof(prevValue));
+    prevPower = state.on;
+
+    if (changed && web_socket.count()) {
+        uint8_t frame[WS_FRAME_MAX];
+        web_socket.binaryAll(frame, ws_state(frame, ++seq));
+    }
+}
+
+// Optional transition time in ms as web request argument t, else the given default
+uint32_t web_fade( AsyncWebServerRequest *request, uint32_t ms = 0 ) {
+    String arg = request->arg("t");
+    return arg.isEmpty() ? ms : (uint32_t)arg.toInt();
+}
+
+// Set channel led (-1 if unknown) to value v with optional transition time, see /channel
+void web_channel( AsyncWebServerRequest *request, int led, const String &v ) {
+    TRACE_BEGIN("web /channel");
+    if (led < 0 || v.isEmpty()) {
+        request->send(400, "text/plain", "unknown channel or missing value");
+    }
+    else {
+        app_value(static_cast<led_t>(led), v.toInt(), web_fade(request));
+        slogf(LOG_INFO, "Slider %s value now %ld. Duty is %d", get_name(static_cast<led_t>(led)), v.toInt(), get_duty(static_cast<led_t>(led)));
+        request->send(204, "text/html", "");  // much smoother slider experience than redirect()
     }
-    snprintf(page, sizeof(page), fmt, get_value(LED_R), get_value(LED_R), 
-        get_value(LED_G), get_value(LED_G), get_value(LED_B), get_value(LED_B), 
-        get_value(LED_W), get_value(LED_W), start_time, curr_time, 
-        influx_time, influx_status, lastBssid, lastRssi, web_msg);
-    *web_msg = '\0';
-    return page;
+    TRACE_END("web /channel");
+}
+
+// Static files from data/ with content hash as ETag
+#ifdef EMBED_ASSETS
+    #include <assets_embedded.h>  // generated by assets.py
+#else
+    static const asset_t assets[] = {
+        { "/bootstrap.min.css",       "text/css",               "\"" ASSET_HASH_BOOTSTRAP_MIN_CSS "\"", NULL, 0 },
+        { "/bootstrap.bundle.min.js", "application/javascript", "\"" ASSET_HASH_BOOTSTRAP_BUNDLE_MIN_JS "\"", NULL, 0 },
+        { "/jquery.min.js",           "application/javascript", "\"" ASSET_HASH_JQUERY_MIN_JS "\"", NULL, 0 },
+        { "/slider.js",               "application/javascript", "\"" ASSET_HASH_SLIDER_JS "\"", NULL, 0 }
+    };
+#endif
+
+// Answer conditional requests with 304 without reading the file or flash.
+// Versioned urls (?v=hash as used by the pages) never change and are cached for a year,
+// others must be revalidated.
+void send_asset( AsyncWebServerRequest *request, const asset_t &asset ) {
+    bool versioned = request->hasParam("v");
+    const char *cache = versioned ? "public, max-age=31536000, immutable" : "no-cache";
+    AsyncWebServerResponse *response;
+
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match").equals(asset.etag)) {
+        response = request->beginResponse(304);
+    }
+    else if (asset.data) {
+        // embedded in flash: sent directly from there, already gzipped
+        response = request->beginResponse(200, asset.type, asset.data, asset.len);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    else {
+        response = request->beginResponse(SPIFFS, asset.url, asset.type);
+    }
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", cache);
+    request->send(response);
 }
 
 // Define web pages for update, reset or for event infos
 void setup_webserver() {
-    // css and js files
-    // web_server.serveStatic("/bootstrap.min.css", fileSys, "/bootstrap.min.css").setCacheControl("max-age=600");
-    web_server.on("/bootstrap.min.css", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send(SPIFFS, "/bootstrap.min.css", "text/css");
-    });
-    // web_server.serveStatic("/bootstrap.bundle.min.js", fileSys, "/bootstrap.bundle.min.js").setCacheControl("max-age=600");
-    web_server.on("/bootstrap.bundle.min.js", HTTP_GET, [](AsyncWebServerRequest *request){
-       request->send(SPIFFS, "/bootstrap.bundle.min.js", "application/javascript");
-    });
-    // web_server.serveStatic("/jquery.min.js", fileSys, "/jquery.min.js").setCacheControl("max-age=600");
-    web_server.on("/jquery.min.js", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send(SPIFFS, "/jquery.min.js", "application/javascript");
-    });
-    // web_server.serveStatic("/slider.js", fileSys, "/slider.js").setCacheControl("max-age=600");
-    web_server.on("/slider.js", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send(SPIFFS, "/slider.js", "application/javascript");
-    });
+    // binary slider frames
+    web_socket.onEvent(ws_event);
+    web_server.addHandler(&web_socket);
+
+    // css and js files (gzipped if there is a .gz file)
+    for (const asset_t &asset : assets) {
+        web_server.on(asset.url, HTTP_GET, [&asset](AsyncWebServerRequest *request){
+            send_asset(request, asset);
+        });
+    }
 
     // change slider value
     web_server.on("/change", HTTP_POST, [](AsyncWebServerRequest *request) {
+        TRACE_BEGIN("web /change");
         uint16_t prio = LOG_INFO;
 
         String arg = request->arg("button");
         if (!arg.isEmpty()) {
             if (arg.equals("button-1")) {
-                snprintf(web_msg, sizeof(web_msg), "Button '%s' pressed: %s", arg.c_str(), app_status(true) ? "ON" : "OFF");
+                snprintf(web_msg, sizeof(web_msg), "Button '%s' pressed: %s", arg.c_str(), app_status(true, web_fade(request, get_fade())) ? "ON" : "OFF");
                 slog(web_msg, prio);
             }
             request->redirect("/");  
         }
         else {
-            for( int i = LED_START; i < LED_COUNT; i++ ) {
-                led_t led = static_cast<led_t>(i);
-                arg = request->arg(get_slider(i));
-                if (!arg.isEmpty()) {
-                    int value = arg.toInt();
-                    app_value(led, value);
-                    // TODO: comment this message for speed
-                    // snprintf(web_msg, sizeof(web_msg), "Slider %d value now %d. Duty is %d", i, value, get_duty(led));
-                    // slog(web_msg, prio);
+            // only look at the posted sliders, not at every channel of the table
+            app_frame_t frame;
+            app_begin(frame);
+            for( size_t p = 0; p < request->params(); p++ ) {
+                const AsyncWebParameter *param = request->getParam(p);
+                const char *name = param->name().c_str();
+                if (strncmp(name, "slider", 6) == 0) {
+                    int led = find_channel(name + 6, strlen(name + 6));
+                    if (led >= 0) {
+                        int value = param->value().toInt();
+                        app_stage(frame, static_cast<led_t>(led), value);
+                        slogf(LOG_INFO, "Slider %s value now %d", get_name(static_cast<led_t>(led)), value);
+                    }
                 }
             }
+            app_commit(frame, web_fade(request));
             // snprintf(web_msg, sizeof(web_msg), "change: heap %d", ESP.getFreeHeap());
             // slog(web_msg);
             request->send(204, "text/html", "");  // much smoother slider experience than redirect()
         }
+        TRACE_END("web /change");
     });
 
-    // change red slider value
-    web_server.on("/r", HTTP_POST, [](AsyncWebServerRequest *request) {
-        led_t led = LED_R;
-        String arg = request->arg(get_slider(led));
-        if (!arg.isEmpty()) {
-            int value = arg.toInt();
-            app_value(led, value);
-            // TODO: comment this message for speed
-            // snprintf(web_msg, sizeof(web_msg), "Slider r value now %d. Duty is %d", value, get_duty(led));
-            // slog(web_msg, LOG_INFO);
-        }
-        request->send(204, "text/html", "");  // much smoother slider experience than redirect()
-    });
-
-    // change green slider value
-    web_server.on("/g", HTTP_POST, [](AsyncWebServerRequest *request) {
-        led_t led = LED_G;
-        String arg = request->arg(get_slider(led));
-        if (!arg.isEmpty()) {
-            int value = arg.toInt();
-            app_value(led, value);
-            // TODO: comment this message for speed
-            // snprintf(web_msg, sizeof(web_msg), "Slider g value now %d. Duty is %d", value, get_duty(led));
-            // slog(web_msg, LOG_INFO);
+    // set several channels and power at once: <channel name or index>=0..1000 (e.g. r=100&green=200),
+    // on (0/1) and t (ms), all optional
+    web_server.on("/color", HTTP_POST, [](AsyncWebServerRequest *request) {
+        TRACE_BEGIN("web /color");
+        app_frame_t frame;
+        app_begin(frame);
+        for( size_t p = 0; p < request->params(); p++ ) {
+            const AsyncWebParameter *param = request->getParam(p);
+            if (param->name().equals("on")) {
+                app_stage_power(frame, param->value().toInt() != 0);
+            }
+            else {
+                int led = find_channel(param->name().c_str(), param->name().length());
+                if (led >= 0) {
+                    app_stage(frame, static_cast<led_t>(led), param->value().toInt());
+                }
+            }
         }
-        request->send(204, "text/html", "");  // much smoother slider experience than redirect()
+        app_commit(frame, web_fade(request));
+        request->send(204, "text/html", "");
+        TRACE_END("web /color");
     });
 
-    // change blue slider value
-    web_server.on("/b", HTTP_POST, [](AsyncWebServerRequest *request) {
-        led_t led = LED_B;
-        String arg = request->arg(get_slider(led));
-        if (!arg.isEmpty()) {
-            int value = arg.toInt();
-            app_value(led, value);
-            // TODO: comment this message for speed
-            // snprintf(web_msg, sizeof(web_msg), "Slider b value now %d. Duty is %d", value, get_duty(led));
-            // slog(web_msg, LOG_INFO);
-        }
-        request->send(204, "text/html", "");  // much smoother slider experience than redirect()
+    // change one channel: c=<index or name>, v=0..1000 and optional t (ms)
+    web_server.on("/channel", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String c = request->arg("c");
+        web_channel(request, find_channel(c.c_str(), c.length()), request->arg("v"));
     });
 
-    // change white slider value
-    web_server.on("/w", HTTP_POST, [](AsyncWebServerRequest *request) {
-        led_t led = LED_W;
-        String arg = request->arg(get_slider(led));
-        if (!arg.isEmpty()) {
-            int value = arg.toInt();
-            app_value(led, value);
-            // TODO: comment this message for speed
-            // snprintf(web_msg, sizeof(web_msg), "Slider w value now %d. Duty is %d", value, get_duty(led));
-            // slog(web_msg, LOG_INFO);
-        }
-        request->send(204, "text/html", "");  // much smoother slider experience than redirect()
-    });
+    // old per channel routes of the fixed RGBW firmware (/r, /g, /b, /w: lower case id) with value slider<index>
+    for( int i = LED_START; i < LED_COUNT; i++ ) {
+        String uri = String("/") + get_id(static_cast<led_t>(i));
+        uri.toLowerCase();
+        web_server.on(uri.c_str(), HTTP_POST, [i](AsyncWebServerRequest *request) {
+            web_channel(request, i, request->arg(get_slider(i)));
+        });
+    }
 
     web_server.on("/json/Wifi", [](AsyncWebServerRequest *request) {
         json_Wifi(msg, sizeof(msg), lastBssid, lastRssi);
@@ -639,10 +978,68 @@ void setup_webserver() {
     });
 
     web_server.on("/json/Pwm", [](AsyncWebServerRequest *request) {
-        json_Pwm(msg, sizeof(msg), get_power());
+        if (json_Pwm(msg, sizeof(msg))) request->send(200, "application/json", msg);
+        else request->send(500, "text/plain", "json_Pwm: buffer too small");
+    });
+
+    web_server.on("/json/Tasks", [](AsyncWebServerRequest *request) {
+        json_Tasks(msg, sizeof(msg));
         request->send(200, "application/json", msg);
     });
 
+    web_server.on("/json/Effect", [](AsyncWebServerRequest *request) {
+        json_Effect(msg, sizeof(msg));
+        request->send(200, "application/json", msg);
+    });
+
+    // select and tune a strip effect: name (off, rainbow, chase, twinkle, gradient), speed, size,
+    // brightness (0..255), color and color2 (hex rrggbb or rrggbbww), all optional
+    web_server.on("/effect", HTTP_POST, [](AsyncWebServerRequest *request) {
+        if (!get_strip()) {
+            request->send(404, "text/plain", "no led strip");
+            return;
+        }
+        effect_params_t p;
+        effects_get(p);
+        String arg = request->arg("name");
+        if (!arg.isEmpty()) {
+            int effect = effects_find(arg.c_str(), arg.length());
+            if (effect < 0) {
+                request->send(400, "text/plain", "unknown effect");
+                return;
+            }
+            p.effect = effect;
+            if (!p.brightness) p.brightness = 255;
+        }
+        if (!(arg = request->arg("speed")).isEmpty()) p.speed = arg.toInt();
+        if (!(arg = request->arg("size")).isEmpty()) p.size = arg.toInt();
+        if (!(arg = request->arg("brightness")).isEmpty()) p.brightness = arg.toInt();
+        uint8_t *colors[] = { p.color, p.color2 };
+        const char *names[] = { "color", "color2" };
+        for (int c = 0; c < 2; c++) {
+            arg = request->arg(names[c]);
+            if (!arg.isEmpty()) {
+                uint32_t rgbw = strtoul(arg.c_str(), NULL, 16);
+                if (arg.length() <= 6) rgbw <<= 8;
+                for (int i = 0; i < 4; i++) colors[c][i] = rgbw >> (24 - 8 * i);
+            }
+        }
+        effects_set(p);
+        request->send(204, "text/html", "");
+    });
+
+#ifdef TRACE
+    // Chrome trace event JSON of recent events
+    web_server.on("/trace", [](AsyncWebServerRequest *request) {
+        std::shared_ptr<trace_cursor_t> cursor = std::make_shared<trace_cursor_t>();  // each dump reads on its own
+        request->send(request->beginChunkedResponse("application/json",
+            [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                if (index == 0) *cursor = trace_cursor_t();
+                return trace_json((char *)buffer, maxLen, *cursor);
+            }));
+    });
+#endif
+
     // Call this page to reset the ESP
     web_server.on("/reset", HTTP_POST, [](AsyncWebServerRequest *request) {
         slog("RESET ESP32", LOG_NOTICE);
@@ -660,7 +1057,7 @@ void setup_webserver() {
 
     // Index page
     web_server.on("/", [](AsyncWebServerRequest *request) { 
-        request->send(200, "text/html", main_page());
+        send_main_page(request);
     });
 
     // Toggle breathing status led if you dont like it or ota does not work
@@ -695,7 +1092,7 @@ void setup_webserver() {
             "  <meta charset=\"utf-8\">\n"
             "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n"
             "  <link href=\"data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAAABAAAAAQAgMAAABinRfyAAAADFBMVEUqYbutnpTMuq/70SQgIef5AAAAVUlEQVQIHWOAAPkvDAyM3+Y7MLA7NV5g4GVqKGCQYWowYTBhapBhMGB04GE4/0X+M8Pxi+6XGS67XzzO8FH+iz/Dl/q/8gx/2S/UM/y/wP6f4T8QAAB3Bx3jhPJqfQAAAABJRU5ErkJggg==\" rel=\"icon\" type=\"image/x-icon\" />\n"
-            "  <link href=\"bootstrap.min.css\" rel=\"stylesheet\">\n"
+            "  <link href=\"" ASSET_BOOTSTRAP_CSS "\" rel=\"stylesheet\">\n"
             "  <title>" PROGNAME " v" VERSION "</title>\n"
             " </head>\n"
             " <body>\n"
@@ -716,7 +1113,7 @@ void setup_webserver() {
             "     </div>\n"
             "    </form>\n"
             "  </div>\n"
-            "  <script src=\"bootstrap.bundle.min.js\"></script>\n"
+            "  <script src=\"" ASSET_BOOTSTRAP_JS "\"></script>\n"
             " </body>\n"
             "</html>\n";
  
@@ -765,7 +1162,7 @@ void setup_webserver() {
     // Catch all page
     web_server.onNotFound( [](AsyncWebServerRequest *request) { 
         snprintf(web_msg, sizeof(web_msg), "%s", "<h2>page not found</h2>\n");
-        request->send(404, "text/html", main_page()); 
+        send_main_page(request, 404);
     });
 
     web_server.begin();
@@ -777,34 +1174,6 @@ void setup_webserver() {
 }
 
 
-// handle on key press
-// pin is pulled up if released and pulled down if pressed
-// return true if &status has changed
-bool handle_button( bool &status ) {
-    static uint32_t prevTime = 0;
-    static uint32_t debounceStatus = 1;
-    static bool pressed = false;
-
-    uint32_t now = millis();
-    if( now - prevTime > 2 ) {  // debounce check every 2 ms, decision after 2ms/bit * 32bit = 64ms
-        prevTime = now;
-
-        // shift bits left, set lowest bit if button pressed
-        debounceStatus = (debounceStatus << 1) | ((digitalRead(BUTTON_PIN) == LOW) ? 1 : 0);
-
-        if( debounceStatus == 0 && pressed ) {
-            pressed = status = false;
-            return true;
-        }
-        else if( debounceStatus == 0xffffffff && !pressed ) {
-            pressed = status = true;
-            return true;
-        }
-    }
-    return false;
-}
-
-
 // check ntp status
 // return true if time is valid
 bool check_ntptime() {
@@ -865,59 +1234,27 @@ void print_reset_reason(int core) {
 
 
 // Called on incoming mqtt messages
+// Commands are parsed in place, see Commands.h
 void mqtt_callback(char* topic, byte* payload, unsigned int length) {
-
-    typedef struct cmd { const char *name; void (*action)(char *args); } cmd_t;
-    
-    static cmd_t cmds[] = { 
-        { "color",  []( char *args ){
-            char *end;
-            int r = (int)strtol(args, &end, 0);
-            if( args != end && r >= 0 && r <= 1000 ) {
-                args = end;
-                int g = (int)strtol(args, &end, 0);
-                if( args != end && g >= 0 && g <= 1000 ) {
-                    args = end;
-                    int b = (int)strtol(args, &end, 0);
-                    if( args != end && b >= 0 && b <= 1000 ) {
-                        args = end;
-                        int w = (int)strtol(args, &end, 0);
-                        if( args != end && w >= 0 && w <= 1000 ) {
-                            app_value(LED_R, r); 
-                            app_value(LED_G, g); 
-                            app_value(LED_B, b); 
-                            app_value(LED_W, w); 
-                        }
-                    }
-                }
-            } } },
-        { "red",    []( char *args ){ app_value(LED_R, max(min(atoi(args), 1000), 0)); } },
-        { "green",  []( char *args ){ app_value(LED_G, max(min(atoi(args), 1000), 0)); } },
-        { "blue",   []( char *args ){ app_value(LED_B, max(min(atoi(args), 1000), 0)); } },
-        { "white",  []( char *args ){ app_value(LED_W, max(min(atoi(args), 1000), 0)); } },
-        { "toggle", []( char *args ){ app_status(true); } },
-        { "on",     []( char *args ){ if (!get_power()) app_status(true); } },
-        { "off",    []( char *args ){ if (get_power()) app_status(true); } }
-    };
-
-    if( length > 0 ) {
-        String data(payload, length);
-
-        if (strcasecmp(MQTT_TOPIC "/cmd", topic) == 0) {
-            for (auto &cmd: cmds) {
-                size_t len = strlen(cmd.name);
-                if (length >= len && strncasecmp(cmd.name, data.c_str(), len) == 0) {
-                    snprintf(msg, sizeof(msg), "Execute mqtt command '%s' with '%.*s'", cmd.name, length-len, &data[len]);
-                    slog(msg, LOG_INFO);
-                    (*cmd.action)(&data[len]);
-                    return;
-                }
-            }
+    static uint32_t prevRejected = 0;
+
+    TRACE_BEGIN("mqtt");
+    if (strcasecmp(MQTT_TOPIC "/cmd", topic) == 0) {
+        command_execute((const char *)payload, length);
+
+        const command_stats_t &stats = get_command_stats();
+        uint32_t rejected = stats.unknown + stats.invalid;
+        if (rejected != prevRejected) {
+            prevRejected = rejected;
+            snprintf(msg, sizeof(msg), "%u", rejected);
+            publish(MQTT_TOPIC "/status/CmdRejected", msg);
         }
     }
-
-    snprintf(msg, sizeof(msg), "Ignore mqtt %s: '%.*s'", topic, length, (char *)payload);
-    slog(msg, LOG_WARNING);
+    else {
+        snprintf(msg, sizeof(msg), "Ignore mqtt %s: '%.*s'", topic, length, (char *)payload);
+        slog(msg, LOG_WARNING);
+    }
+    TRACE_END("mqtt");
 }
 
 
@@ -969,6 +1306,7 @@ void handle_reboot() {
         }
         else {
             if (now - start > reboot_delay) {
+                logger.drain(log_sink);
                 ESP.restart();
             }
         }
@@ -983,7 +1321,7 @@ void setup() {
     pinMode(HEALTH_LED_PIN, OUTPUT);
     digitalWrite(HEALTH_LED_PIN, HEALTH_LED_INVERTED ? LOW : HIGH);
 
-    pinMode(BUTTON_PIN, INPUT_PULLUP);  // to toggle load status
+    button.begin();  // to toggle load status
 
     Serial.begin(BAUDRATE);
     // #if defined(CONFIG_IDF_TARGET_ESP32S3)
@@ -1000,10 +1338,10 @@ void setup() {
 
     Serial.println("\nStarting " PROGNAME " v" VERSION " " __DATE__ " " __TIME__);
 
-    Serial.print("Pins for RGBW are");
+    Serial.print("Pins of channels are");
     for( int i = LED_START; i < LED_COUNT; i++ ) {
         led_t led = static_cast<led_t>(i);
-        Serial.printf(" %u", get_pin(led));
+        Serial.printf(" %s=%u", get_name(led), get_pin(led));
     }
     Serial.println();
 
@@ -1012,7 +1350,9 @@ void setup() {
     WiFi.hostname(host.c_str());
     WiFi.mode(WIFI_STA);
 
-    // Syslog setup
+    // Syslog setup, more infos per second are dropped
+    logger.limit(LOG_INFO, 10);
+    logger.limit(LOG_DEBUG, 10);
     syslog.server(SYSLOG_SERVER, SYSLOG_PORT);
     syslog.deviceHostname(hostname());
     syslog.appName("Joba1");
@@ -1048,10 +1388,14 @@ void setup() {
 
     MDNS.begin(hostname());
 
-    fileSys.begin();
+    #ifndef EMBED_ASSETS
+        fileSys.begin();  // web assets are served from the filesystem
+    #endif
 
     setup_webserver();
 
+    influx.begin();
+
     mqtt.setServer(MQTT_SERVER, MQTT_PORT);
     mqtt.setCallback(mqtt_callback);
 
@@ -1064,35 +1408,98 @@ void setup() {
     health_led.begin();
 
     setup_app(true);  // TODO done twice since sometimes light stays off until toggled twice
+    effects_begin(get_strip());
+
+    setup_tasks();
 
     slog("Setup done", LOG_NOTICE);
 }
 
 
-// Main loop
-void loop() {
-    bool button_pressed;
-    bool health = true;
-
-    health &= handle_app();
-    
-    bool have_time = check_ntptime();
-
-    health &= handle_mqtt(have_time);
-    health &= handle_wifi();
-
-    if (handle_button(button_pressed)) {
-        app_status(button_pressed);
+// Main loop tasks, see setup_tasks()
+bool health_app = true;
+bool health_mqtt = false;
+bool health_wifi = false;
+bool have_time = false;
+
+// Consume button events, the interrupt and timer keep detecting them while this is late.
+// A hold ramps from the channel mix at its start, each step fades over the repeat interval.
+// Holds alternate between up and down, from off or at the minimum it goes up.
+void task_button() {
+    static app_snapshot_t mix;  // state at the start of the hold
+    static int level = 0;       // brightest channel while ramping
+    static int step = BUTTON_RAMP_STEP;
+
+    button.handle();
+    button_event_t e;
+    while (button.event(e)) {
+        switch (e.type) {
+            case BUTTON_CLICK:
+                app_status(true, get_fade());
+                break;
+            case BUTTON_DOUBLE:
+                app_snapshot(mix);
+                app_level(mix, 1000, get_fade());
+                break;
+            case BUTTON_HOLD:
+                app_snapshot(mix);
+                level = 0;
+                if (mix.on) {
+                    for (int led = 0; led < LED_COUNT; led++) {
+                        if (mix.value[led] > level) level = mix.value[led];
+                    }
+                }
+                step = (level <= BUTTON_RAMP_STEP) ? BUTTON_RAMP_STEP : (level >= 1000) ? -BUTTON_RAMP_STEP : -step;
+                [[fallthrough]];  // first step
+            case BUTTON_REPEAT:
+                if (level + step >= 1 && level + step <= 1000) {
+                    level += step;
+                    app_level(mix, level, BUTTON_REPEAT_MS);
+                }
+                break;
+            default:
+                continue;
+        }
+        if (e.type != BUTTON_REPEAT) button.applied(e);
     }
+}
 
-    health &= (influx_status >= 200 && influx_status < 300);
-
-    report_pwm(get_power());
+void task_app() { health_app = handle_app(); }
+void task_pwm() { report_pwm(); }
+void task_ntp() { have_time = check_ntptime(); }
+void task_mqtt() { health_mqtt = handle_mqtt(have_time); }
+void task_wifi() { health_wifi = handle_wifi(); }
 
+void task_breathe() {
     if (have_time && enabledBreathing) {
+        bool health = health_app && health_mqtt && health_wifi
+            && influx_status >= 200 && influx_status < 300;
         health_led.interval(health ? health_ok_interval : health_err_interval);
         health_led.handle();
     }
+    else {
+        health_led.stop();
+    }
+}
 
-    handle_reboot();
-}
\ No newline at end of file
+// Register loop handlers: name, function, period, priority, deadline
+// Button and pwm output first, network last
+void setup_tasks() {
+    scheduler.add("button",  task_button,     2, 0,    2);
+    scheduler.add("app",     task_app,       10, 1,   10);
+    scheduler.add("ws",      handle_ws,      50, 2,   50);
+    scheduler.add("breathe", task_breathe,   20, 3,   20);
+    scheduler.add("pwm",     task_pwm,      100, 4,  100);
+    scheduler.add("mqtt",    task_mqtt,      10, 5,  100);
+    scheduler.add("influx",  handle_influx, 100, 6, 1000);
+    scheduler.add("wifi",    task_wifi,    1000, 7, 1000);
+    scheduler.add("ntp",     task_ntp,     1000, 8, 1000);
+    scheduler.add("reboot",  handle_reboot, 100, 9, 1000);
+    scheduler.add("log",     handle_log,     20, 10, 1000);
+}
+
+
+// Main loop
+void loop() {
+    scheduler.run();
+}
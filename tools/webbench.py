@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+"""HTTP and websocket load benchmark for the SliderPwm web endpoints
+
+Fires a request mix per route with increasing numbers of concurrent
+keep-alive clients (simulated browsers) and reports throughput, p50/p99
+latency, time to first byte and the lowest free heap seen by the firmware (from /json/Tasks).
+Route ws sends binary slider frames over /ws instead. Its latency is from
+sending a value until a state broadcast shows it, so it includes the up to
+50 ms broadcast coalescing the http slider route does not see.
+Results are written as JSON to compare firmware versions.
+
+Usage: webbench.py [-d seconds] [-c 1,2,4] [-o results.json] host[:port]
+"""
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import random
+import socket
+import struct
+import threading
+import time
+
+WS_POWER_BIT = 0x80000000
+
+
+def slider():
+    i = random.randrange(4)
+    return 'POST', '/channel', 'c=%d&v=%d' % (i, random.randint(0, 1000))
+
+
+def change():
+    return 'POST', '/change', '&'.join('slider%d=%d' % (i, random.randint(0, 1000)) for i in range(4))
+
+
+# route name: function returning method, path and form body of the next request
+ROUTES = {
+    'slider': slider,
+    'change': change,
+    'json': lambda: ('GET', '/json/Pwm', None),
+    'page': lambda: ('GET', '/', None),
+    'ws': None,  # see ws_client()
+}
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def get_json(host, port, path):
+    conn = http.client.HTTPConnection(host, port, timeout=5)
+    try:
+        conn.request('GET', path)
+        return json.loads(conn.getresponse().read())
+    finally:
+        conn.close()
+
+
+def client(host, port, route, until, latencies, ttfbs, errors):
+    conn = http.client.HTTPConnection(host, port, timeout=5)
+    headers = {'Content-Type': 'application/x-www-form-urlencoded'}
+    while time.monotonic() < until:
+        method, path, body = ROUTES[route]()
+        start = time.monotonic()
+        try:
+            conn.request(method, path, body=body, headers=headers if body else {})
+            resp = conn.getresponse()
+            ttfb = time.monotonic() - start
+            resp.read()
+            if resp.status >= 400:
+                errors.append(resp.status)
+            else:
+                latencies.append(time.monotonic() - start)
+                ttfbs.append(ttfb)
+        except (OSError, http.client.HTTPException) as e:
+            errors.append(str(e))
+            conn.close()
+            conn = http.client.HTTPConnection(host, port, timeout=5)
+    conn.close()
+
+
+class WebSocket:
+    """Minimal RFC 6455 client: binary frames, no fragmentation, no extensions"""
+
+    def __init__(self, host, port, path, timeout=5):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(('GET %s HTTP/1.1\r\nHost: %s:%d\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n'
+                           'Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n' % (path, host, port, key)).encode())
+        self.buf = b''
+        while b'\r\n\r\n' not in self.buf:
+            self.fill()
+        head, _, self.buf = self.buf.partition(b'\r\n\r\n')
+        if not head.startswith(b'HTTP/1.1 101'):
+            raise OSError('websocket upgrade refused: %s' % head.split(b'\r\n')[0].decode(errors='replace'))
+
+    def fill(self):
+        data = self.sock.recv(4096)
+        if not data:
+            raise OSError('websocket closed')
+        self.buf += data
+
+    def take(self, n):
+        while len(self.buf) < n:
+            self.fill()
+        data, self.buf = self.buf[:n], self.buf[n:]
+        return data
+
+    def send(self, payload, opcode=0x2):
+        mask = os.urandom(4)
+        n = len(payload)
+        head = struct.pack('!BB', 0x80 | opcode, 0x80 | n) if n < 126 else struct.pack('!BBH', 0x80 | opcode, 0xfe, n)
+        self.sock.sendall(head + mask + bytes(b ^ mask[i & 3] for i, b in enumerate(payload)))
+
+    def recv(self):
+        """Next binary payload, answers pings"""
+        while True:
+            b0, b1 = self.take(2)
+            n = b1 & 0x7f
+            if n == 126:
+                n, = struct.unpack('!H', self.take(2))
+            elif n == 127:
+                n, = struct.unpack('!Q', self.take(8))
+            payload = self.take(n)
+            opcode = b0 & 0x0f
+            if opcode == 0x2:
+                return payload
+            if opcode == 0x8:
+                raise OSError('websocket closed')
+            if opcode == 0x9:
+                self.send(payload, 0xa)
+
+    def close(self):
+        try:
+            self.send(b'', 0x8)
+        except OSError:
+            pass
+        self.sock.close()
+
+
+def ws_values(frame):
+    """Slider values by channel of a state frame (mask, seq, values, power)"""
+    mask, = struct.unpack_from('<I', frame)
+    values, pos = {}, 6
+    for c in range(31):
+        if mask & (1 << c) and pos + 2 <= len(frame):
+            values[c], = struct.unpack_from('<H', frame, pos)
+            pos += 2
+    return values
+
+
+def ws_client(host, port, index, until, latencies, errors):
+    """Set a value on one channel and wait until a broadcast shows it, like a dragged slider"""
+    ws = None
+    seq = 0
+    while time.monotonic() < until:
+        try:
+            if ws is None:
+                ws = WebSocket(host, port, '/ws')
+                values = ws_values(ws.recv())  # state on connect
+                channel = sorted(values)[index % len(values)]
+            value = random.randint(0, 1000)
+            if value == values[channel]:
+                value = (value + 1) % 1001
+            seq = (seq + 1) & 0xffff
+            start = time.monotonic()
+            ws.send(struct.pack('<IHH', 1 << channel, seq, value))
+            while True:
+                values = ws_values(ws.recv())
+                if values.get(channel) == value:
+                    latencies.append(time.monotonic() - start)
+                    break
+        except (OSError, ValueError, struct.error) as e:
+            errors.append(str(e))  # includes timeouts when other clients overwrite the channel
+            if ws:
+                ws.close()
+            ws = None
+    if ws:
+        ws.close()
+
+
+def run(host, port, route, clients, duration):
+    latencies, ttfbs, errors = [], [], []
+    until = time.monotonic() + duration
+    if route == 'ws':
+        threads = [threading.Thread(target=ws_client, args=(host, port, i, until, latencies, errors))
+                   for i in range(clients)]
+    else:
+        threads = [threading.Thread(target=client, args=(host, port, route, until, latencies, ttfbs, errors))
+                   for _ in range(clients)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    heap = get_json(host, port, '/json/Tasks').get('Heap', {})
+    return {
+        'route': route,
+        'clients': clients,
+        'requests': len(latencies),
+        'errors': len(errors),
+        'rps': round(len(latencies) / duration, 1),
+        'p50_ms': round(percentile(latencies, 50) * 1000, 1) if latencies else None,
+        'p99_ms': round(percentile(latencies, 99) * 1000, 1) if latencies else None,
+        'ttfb_p50_ms': round(percentile(ttfbs, 50) * 1000, 1) if ttfbs else None,
+        'min_free_heap': heap.get('Min'),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', help='device host[:port]')
+    parser.add_argument('-d', '--duration', type=float, default=10, help='seconds per run')
+    parser.add_argument('-c', '--clients', default='1,2,4', help='concurrent clients per run')
+    parser.add_argument('-r', '--routes', default=','.join(ROUTES), help='routes to run (%s)' % ','.join(ROUTES))
+    parser.add_argument('-o', '--output', default='webbench.json', help='result file')
+    args = parser.parse_args()
+
+    host, _, port = args.host.partition(':')
+    port = int(port or 80)
+    info = get_json(host, port, '/json/Pwm')
+
+    results = []
+    for route in args.routes.split(','):
+        for clients in map(int, args.clients.split(',')):
+            r = run(host, port, route, clients, args.duration)
+            print('%-6s clients=%-2d rps=%-7s p50=%-6s p99=%-6s ttfb=%-6s errors=%-3d min heap=%s' % (
+                r['route'], r['clients'], r['rps'], r['p50_ms'], r['p99_ms'], r['ttfb_p50_ms'], r['errors'],
+                r['min_free_heap']))
+            results.append(r)
+
+    with open(args.output, 'w') as f:
+        json.dump({'host': info.get('Hostname'), 'version': info.get('Version'),
+                   'time': time.strftime('%FT%T'), 'duration': args.duration, 'results': results}, f, indent=1)
+
+
+if __name__ == '__main__':
+    main()